@@ -16,45 +16,160 @@ std::vector<std::vector<double>> inputs = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
 std::vector<std::vector<double>> targets = {{0}, {1}, {1}, {0}};
 
 /*
- * @brief Train model and save model
+ * @brief Train model in double precision and save model
  */
 void trainMode() {
   std::cout << "=== Train model ===" << std::endl;
 
   // build layers
-  std::vector<std::unique_ptr<Layer>> layers;
-  layers.emplace_back(std::make_unique<ReLULayer>(2, 8, "layer1.txt"));
-  layers.emplace_back(std::make_unique<TanhLayer>(8, 4, "layer2.txt"));
-  layers.emplace_back(std::make_unique<SigmoidLayer>(4, 1, "layer3.txt"));
+  std::vector<std::unique_ptr<Layer<double>>> layers;
+  layers.emplace_back(std::make_unique<ReLULayer<double>>(2, 8, "layer1.txt"));
+  layers.emplace_back(std::make_unique<TanhLayer<double>>(8, 4, "layer2.txt"));
+  layers.emplace_back(
+      std::make_unique<SigmoidLayer<double>>(4, 1, "layer3.txt"));
 
   // build model
-  SequentialModel model(std::move(layers), std::make_unique<MSE>(),
-                        std::make_unique<SGD>(0.1), 1000);
+  SequentialModel<double> model(std::move(layers),
+                                std::make_unique<MSE<double>>(),
+                                std::make_unique<SGD<double>>(0.1), 1000);
 
   // train model
   model.train(inputs, targets);
 
-  // save parameters
+  // save parameters, per layer and as one archive with the architecture
   model.saveParams();
+  model.save("model.ckpt");
 }
 
 /*
- * @brief Download parameters and make predictions
+ * @brief Load the archive into a float model and make predictions
  */
 void inferenceMode() {
   std::cout << "=== Inference ===" << std::endl;
 
-  std::vector<std::unique_ptr<Layer>> layers;
-  layers.emplace_back(std::make_unique<ReLULayer>(2, 8, "layer1.txt"));
-  layers.emplace_back(std::make_unique<TanhLayer>(8, 4, "layer2.txt"));
-  layers.emplace_back(std::make_unique<SigmoidLayer>(4, 1, "layer3.txt"));
+  // layers are rebuilt from the archive (saved as float64, converted to
+  // float32)
+  std::unique_ptr<SequentialModel<float>> loaded =
+      SequentialModel<float>::load("model.ckpt");
+  SequentialModel<float> &model = *loaded;
 
-  SequentialModel model(std::move(layers), std::make_unique<MSE>(),
-                        std::make_unique<SGD>(0.1), 1000);
+  // serving only: drop gradients and training buffers
+  MemoryUsage before = model.memoryUsage();
+  model.setTraining(false);
+  MemoryUsage after = model.memoryUsage();
+  std::cout << "Gradient memory: " << before.gradients << " -> "
+            << after.gradients << " bytes" << std::endl;
 
-  // download parameters
+  std::cout << "Results:" << std::endl;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    vector<float> input(inputs[i].begin(), inputs[i].end());
+    vector<float> prediction = model.predict(input);
+    std::cout << inputs[i][0] << " XOR " << inputs[i][1] << " = "
+              << prediction[0] << " (expected: " << targets[i][0] << ")"
+              << std::endl;
+  }
+}
+
+/*
+ * @brief Quantize the model to int8 and compare it with the float model
+ */
+void quantizedMode() {
+  std::cout << "=== Int8 inference ===" << std::endl;
+
+  std::vector<std::unique_ptr<Layer<float>>> layers;
+  // the parameters are downloaded next: skip the random initialization
+  layers.emplace_back(std::make_unique<ReLULayer<float>>(
+      2, 8, "layer1.txt", ParameterInit::Deferred));
+  layers.emplace_back(std::make_unique<TanhLayer<float>>(
+      8, 4, "layer2.txt", ParameterInit::Deferred));
+  layers.emplace_back(std::make_unique<SigmoidLayer<float>>(
+      4, 1, "layer3.txt", ParameterInit::Deferred));
+
+  SequentialModel<float> model(std::move(layers),
+                               std::make_unique<MSE<float>>(),
+                               std::make_unique<SGD<float>>(0.1f), 1000);
   model.downloadParams();
 
+  std::vector<std::vector<float>> samples, answers;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    samples.emplace_back(inputs[i].begin(), inputs[i].end());
+    answers.emplace_back(targets[i].begin(), targets[i].end());
+  }
+
+  // calibrate on the training inputs
+  model.quantize(samples);
+
+  std::cout << "Results:" << std::endl;
+  for (size_t i = 0; i < samples.size(); i++) {
+    vector<float> prediction = model.predictQuantized(samples[i]);
+    std::cout << inputs[i][0] << " XOR " << inputs[i][1] << " = "
+              << prediction[0] << " (expected: " << targets[i][0] << ")"
+              << std::endl;
+  }
+
+  QuantizationReport<float> report = model.quantizationReport(samples, answers);
+  std::cout << "Loss: " << report.loss << " float, " << report.quantized_loss
+            << " int8" << std::endl;
+  std::cout << "Output error: max " << report.max_abs_error << ", mean "
+            << report.mean_abs_error << std::endl;
+  std::cout << "Parameters: " << report.bytes << " bytes float, "
+            << report.quantized_bytes << " bytes int8" << std::endl;
+}
+
+/*
+ * @brief Keep weights in bfloat16 and make predictions
+ */
+void halfMode() {
+  std::cout << "=== Bfloat16 weights ===" << std::endl;
+
+  std::vector<std::unique_ptr<Layer<float>>> layers;
+  // the parameters are downloaded next: skip the random initialization
+  layers.emplace_back(std::make_unique<ReLULayer<float>>(
+      2, 8, "layer1.txt", ParameterInit::Deferred));
+  layers.emplace_back(std::make_unique<TanhLayer<float>>(
+      8, 4, "layer2.txt", ParameterInit::Deferred));
+  layers.emplace_back(std::make_unique<SigmoidLayer<float>>(
+      4, 1, "layer3.txt", ParameterInit::Deferred));
+
+  SequentialModel<float> model(std::move(layers),
+                               std::make_unique<MSE<float>>(),
+                               std::make_unique<SGD<float>>(0.1f), 1000);
+  model.downloadParams();
+
+  // weights are rounded to bfloat16, sums are still computed in float
+  model.setWeightPrecision(WeightPrecision::BFloat16);
+
+  std::cout << "Results:" << std::endl;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    vector<float> input(inputs[i].begin(), inputs[i].end());
+    vector<float> prediction = model.predict(input);
+    std::cout << inputs[i][0] << " XOR " << inputs[i][1] << " = "
+              << prediction[0] << " (expected: " << targets[i][0] << ")"
+              << std::endl;
+  }
+}
+
+/*
+ * @brief Train a fresh model with lock-free parallel SGD and compare
+ */
+void hogwildMode() {
+  std::cout << "=== Hogwild training ===" << std::endl;
+
+  std::vector<std::unique_ptr<Layer<double>>> layers;
+  layers.emplace_back(
+      std::make_unique<ReLULayer<double>>(2, 8, "hogwild1.txt"));
+  layers.emplace_back(
+      std::make_unique<TanhLayer<double>>(8, 4, "hogwild2.txt"));
+  layers.emplace_back(
+      std::make_unique<SigmoidLayer<double>>(4, 1, "hogwild3.txt"));
+
+  SequentialModel<double> model(std::move(layers),
+                                std::make_unique<MSE<double>>(),
+                                std::make_unique<SGD<double>>(0.1), 1000);
+
+  // 2 workers, one per half of the samples, updating shared weights
+  model.trainHogwild(inputs, targets, 2);
+
   std::cout << "Results:" << std::endl;
   for (size_t i = 0; i < inputs.size(); i++) {
     vector<double> prediction = model.predict(inputs[i]);
@@ -68,6 +183,9 @@ int main() {
 
   trainMode();
   inferenceMode();
+  quantizedMode();
+  halfMode();
+  hogwildMode();
 
   return 0;
 }
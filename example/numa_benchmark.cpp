@@ -0,0 +1,129 @@
+#include "../include/Numa.h"
+#include "../include/SequentialModel.h"
+#include "../include/layers/ReLULayer.h"
+#include "../include/layers/SigmoidLayer.h"
+#include "../include/loss/MSE.h"
+#include "../include/optimizers/SGD.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+const int input_size = 256;
+const int hidden_size = 1024;
+const int output_size = 10;
+const int samples = 1024;
+const int batch_size = 256;
+const int shard_size = 16;
+const int epochs = 10;
+
+/*
+ * @brief Seconds per epoch of trainDataParallel, and where the parameters
+ * it reads live
+ */
+struct RunResult {
+  double seconds_per_epoch;
+  std::vector<int> layer_nodes; // node of each layer's weights, -1 unknown
+  std::vector<size_t> layer_bytes;
+};
+
+RunResult run(const std::vector<std::vector<float>> &inputs,
+              const std::vector<std::vector<float>> &targets, int threads,
+              bool numa_aware) {
+  std::vector<std::unique_ptr<Layer<float>>> layers;
+  layers.emplace_back(
+      std::make_unique<ReLULayer<float>>(input_size, hidden_size, ""));
+  layers.emplace_back(
+      std::make_unique<ReLULayer<float>>(hidden_size, hidden_size, ""));
+  layers.emplace_back(
+      std::make_unique<SigmoidLayer<float>>(hidden_size, output_size, ""));
+
+  RunResult result;
+  for (std::unique_ptr<Layer<float>> &layer : layers) {
+    ParameterView<float> weights = layer->parameter(0);
+    result.layer_nodes.push_back(numa::nodeOf(weights.values));
+    result.layer_bytes.push_back(weights.size * sizeof(float));
+  }
+
+  SequentialModel<float> model(std::move(layers),
+                               std::make_unique<MSE<float>>(),
+                               std::make_unique<SGD<float>>(0.01f), epochs);
+
+  Clock::time_point start = Clock::now();
+  model.trainDataParallel(inputs, targets, threads, batch_size, shard_size,
+                          numa_aware);
+  result.seconds_per_epoch =
+      std::chrono::duration<double>(Clock::now() - start).count() / epochs;
+  return result;
+}
+
+int main() {
+  size_t nodes = numa::nodes();
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::vector<float>> inputs(samples,
+                                         std::vector<float>(input_size));
+  std::vector<std::vector<float>> targets(samples,
+                                          std::vector<float>(output_size));
+  for (int n = 0; n < samples; n++) {
+    for (int i = 0; i < input_size; i++) {
+      inputs[n][i] = std::sin(0.01f * (n + 3 * i));
+    }
+    targets[n][n % output_size] = 1.0f;
+  }
+
+  std::printf("%zu NUMA node(s), %d threads, %d-%d-%d-%d float model, "
+              "batch %d, shard %d\n\n",
+              nodes, threads, input_size, hidden_size, hidden_size,
+              output_size, batch_size, shard_size);
+
+  RunResult shared = run(inputs, targets, threads, false);
+  RunResult aware = run(inputs, targets, threads, true);
+
+  // Parameter bytes read from another node in one optimizer step. Without
+  // replicas, every shard computed off the node holding a layer reads its
+  // weights across the interconnect (the forward and the backward read
+  // them; counted once, as if they stayed in cache in between). With
+  // replicas, only the refresh after the step copies them, once per other
+  // node that runs shards.
+  size_t shards = (batch_size + shard_size - 1) / shard_size;
+  size_t slots = std::min<size_t>(threads, shards);
+  size_t shared_remote = 0;
+  size_t aware_remote = 0;
+  for (size_t i = 0; i < shared.layer_bytes.size(); i++) {
+    size_t home = std::max(0, shared.layer_nodes[i]);
+    for (size_t s = 0; s < shards; s++) {
+      // without pinning, shards land on any node; assume an even spread
+      if (nodes > 1 && s % nodes != home)
+        shared_remote += shared.layer_bytes[i];
+    }
+
+    std::vector<bool> used(nodes, false);
+    for (size_t w = 0; w < slots; w++) {
+      used[w * nodes / slots] = true;
+    }
+    for (size_t node = 0; node < nodes; node++) {
+      if (used[node] && node != home)
+        aware_remote += aware.layer_bytes[i];
+    }
+  }
+
+  std::printf("%-16s %14s %22s\n", "setting", "ms per epoch",
+              "remote KiB per step");
+  std::printf("%-16s %14.2f %22.0f\n", "shared",
+              1e3 * shared.seconds_per_epoch, shared_remote / 1024.0);
+  std::printf("%-16s %14.2f %22.0f\n", "numa_aware",
+              1e3 * aware.seconds_per_epoch, aware_remote / 1024.0);
+
+  if (nodes < 2) {
+    std::printf("\nSingle-node machine: every access is local, numa_aware "
+                "only pins the threads.\n");
+  }
+  return 0;
+}
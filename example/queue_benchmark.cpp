@@ -0,0 +1,137 @@
+#include "../include/InferenceQueue.h"
+#include "../include/SequentialModel.h"
+#include "../include/layers/ReLULayer.h"
+#include "../include/layers/SigmoidLayer.h"
+#include "../include/loss/MSE.h"
+#include "../include/optimizers/SGD.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+const int input_size = 256;
+const int hidden_size = 512;
+const int output_size = 10;
+const int clients = 64;                             // concurrent requests
+const std::chrono::milliseconds duration(1000);     // per setting
+
+/*
+ * @brief Throughput and latency percentiles of one load run
+ */
+struct LoadResult {
+  double requests_per_second;
+  double p50_us;
+  double p95_us;
+  double p99_us;
+};
+
+/*
+ * @brief Latency percentile of sorted samples, in microseconds
+ */
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+  return sorted[index];
+}
+
+/*
+ * @brief Run clients in a closed loop for the benchmark duration
+ * @param request send one request and wait for its result
+ */
+template <typename Request> LoadResult runLoad(Request request) {
+  std::vector<std::vector<double>> latencies(clients);
+  std::vector<std::thread> threads;
+  Clock::time_point end = Clock::now() + duration;
+
+  for (int c = 0; c < clients; c++) {
+    threads.emplace_back([&, c] {
+      std::vector<float> input(input_size);
+      for (int i = 0; i < input_size; i++) {
+        input[i] = std::sin(0.1f * (c + i));
+      }
+
+      while (Clock::now() < end) {
+        Clock::time_point start = Clock::now();
+        request(input);
+        latencies[c].push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<double> all;
+  for (std::vector<double> &samples : latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  std::sort(all.begin(), all.end());
+
+  double seconds = std::chrono::duration<double>(duration).count();
+  return {all.size() / seconds, percentile(all, 0.50), percentile(all, 0.95),
+          percentile(all, 0.99)};
+}
+
+void printResult(const char *name, const LoadResult &result) {
+  std::printf("%-24s %12.0f %10.0f %10.0f %10.0f\n", name,
+              result.requests_per_second, result.p50_us, result.p95_us,
+              result.p99_us);
+}
+
+int main() {
+  std::vector<std::unique_ptr<Layer<float>>> layers;
+  layers.emplace_back(
+      std::make_unique<ReLULayer<float>>(input_size, hidden_size, ""));
+  layers.emplace_back(
+      std::make_unique<ReLULayer<float>>(hidden_size, hidden_size, ""));
+  layers.emplace_back(
+      std::make_unique<SigmoidLayer<float>>(hidden_size, output_size, ""));
+
+  SequentialModel<float> model(std::move(layers),
+                               std::make_unique<MSE<float>>(),
+                               std::make_unique<SGD<float>>(0.1f), 1);
+  model.setTraining(false);
+  const SequentialModel<float> &serving = model;
+
+  std::printf("%d clients, %d-%d-%d-%d float model, %lld ms per setting\n\n",
+              clients, input_size, hidden_size, hidden_size, output_size,
+              static_cast<long long>(duration.count()));
+  std::printf("%-24s %12s %10s %10s %10s\n", "setting", "requests/s",
+              "p50 us", "p95 us", "p99 us");
+
+  // Baseline: every client runs its own single-sample forward
+  printResult("unbatched", runLoad([&](const std::vector<float> &input) {
+                thread_local Arena scratch;
+                float output[output_size];
+                serving.predictInto(input.data(), output, scratch);
+              }));
+
+  const size_t batch_sizes[] = {8, 32, 64};
+  const int waits_us[] = {100, 1000, 5000};
+
+  for (size_t max_batch : batch_sizes) {
+    for (int wait_us : waits_us) {
+      InferenceQueue<float> queue(serving, max_batch,
+                                  std::chrono::microseconds(wait_us));
+
+      char name[64];
+      std::snprintf(name, sizeof(name), "batch %zu, wait %d us", max_batch,
+                    wait_us);
+      printResult(name, runLoad([&](const std::vector<float> &input) {
+                    queue.submit(input).get();
+                  }));
+    }
+  }
+
+  return 0;
+}
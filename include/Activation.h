@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 // Helper activation functions
 namespace activation {
 
@@ -10,4 +12,57 @@ double sigmoid_derivative(double x);
 double tanh(double x);
 
 double tanh_derivative(double x);
+
+/*
+ * @brief Accuracy of the vectorized sigmoid and tanh helpers
+ *
+ * Exact (default) stays within about 1 ulp of the true value. Fast uses an
+ * exp-free rational approximation that is roughly 2-4x cheaper, with maximum
+ * absolute errors fast_sigmoid_max_error and fast_tanh_max_error.
+ * Derivatives are computed from the activation output in both modes.
+ */
+enum class Mode { Exact, Fast };
+
+constexpr double fast_sigmoid_max_error = 3.7e-5;
+
+constexpr double fast_tanh_max_error = 7.3e-5;
+
+/*
+ * @brief Slope of leaky ReLU for negative inputs
+ */
+constexpr double leaky_relu_slope = 0.01;
+
+/*
+ * @brief Select the accuracy mode for all following activation calls
+ */
+void setMode(Mode mode);
+
+/*
+ * @brief Get the current accuracy mode
+ */
+Mode getMode();
+
+// Vectorized helpers over n contiguous values of T (float or double). They
+// run the SIMD kernel (AVX-512, AVX2, SSE2 or scalar) chosen for this CPU at
+// startup. Derivative helpers apply the chain rule: out = grad * f'(...)
+
+template <typename T> void relu(const T *z, T *out, size_t n);
+
+template <typename T>
+void relu_derivative(const T *z, const T *grad, T *out, size_t n);
+
+template <typename T> void leaky_relu(const T *z, T *out, size_t n);
+
+template <typename T>
+void leaky_relu_derivative(const T *z, const T *grad, T *out, size_t n);
+
+template <typename T> void sigmoid(const T *z, T *out, size_t n);
+
+template <typename T>
+void sigmoid_derivative(const T *y, const T *grad, T *out, size_t n);
+
+template <typename T> void tanh(const T *z, T *out, size_t n);
+
+template <typename T>
+void tanh_derivative(const T *y, const T *grad, T *out, size_t n);
 } // namespace activation
@@ -0,0 +1,178 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "Matrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Binary parameter checkpoints.
+ *
+ * A checkpoint file holds, little-endian:
+ *
+ *   FileHeader       64 bytes: magic, version, byte order, counts, checksum
+ *   TensorRecord     64 bytes per tensor: dtype, shape, stride, offset
+ *   metadata         free text, may be empty
+ *   payloads         one per tensor, each at a multiple of
+ *                    payload_alignment, zero bytes in between
+ *
+ * Payloads keep the row padding of the matrices they were written from, so
+ * a loader can point its matrices straight at the file's memory instead of
+ * parsing or copying it. The header checksum covers the header, the table
+ * and the metadata; every payload has its own, checked on request since
+ * that reads the whole file.
+ */
+namespace checkpoint {
+
+constexpr uint32_t version = 1;
+constexpr size_t payload_alignment = 64; // at least Matrix::alignment
+
+/*
+ * @brief Element type of a stored tensor
+ */
+enum class DType : uint32_t {
+  Float32 = 1,
+  Float64 = 2,
+  BFloat16 = 3,
+  Float16 = 4
+};
+
+/*
+ * @brief DType of float and double
+ */
+template <typename T> DType dtypeOf();
+template <> inline DType dtypeOf<float>() { return DType::Float32; }
+template <> inline DType dtypeOf<double>() { return DType::Float64; }
+
+/*
+ * @brief Size of one element of a dtype, in bytes
+ */
+size_t elementSize(DType dtype);
+
+/*
+ * @brief A tensor of a loaded checkpoint
+ *
+ * data stays valid while the Reader, or a copy of its memory(), is alive.
+ * It is writable: mappings are private, so writes never reach the file.
+ */
+struct Tensor {
+  DType dtype;
+  size_t rows;
+  size_t cols;
+  size_t stride; // distance between rows, in elements
+  void *data;
+};
+
+/*
+ * @brief Collects matrices and writes them as one checkpoint
+ *
+ * Matrices are referenced, not copied, until write().
+ */
+class Writer {
+private:
+  struct Entry {
+    DType dtype;
+    size_t rows;
+    size_t cols;
+    size_t stride;
+    const void *data;
+  };
+  std::vector<Entry> entries;
+
+public:
+  void add(const Matrix<float> &matrix);
+  void add(const Matrix<double> &matrix);
+
+  /*
+   * @brief Add a matrix of 16-bit values
+   * @param dtype BFloat16 or Float16
+   */
+  void add(const Matrix<uint16_t> &matrix, DType dtype);
+
+  /*
+   * @brief Write the header, the matrices and metadata to a file
+   *
+   * The file is written under a temporary name, synced and renamed, so a
+   * reader never sees a partial checkpoint.
+   */
+  void write(const std::string &path, const std::string &metadata = "") const;
+};
+
+/*
+ * @brief Loaded checkpoint whose tensors are read in order
+ *
+ * A copy shares the memory and reads on from the same tensor on its own,
+ * e.g. to check tensors before loading them.
+ */
+class Reader {
+private:
+  std::shared_ptr<void> buffer; // mapping or heap copy of the whole file
+  std::vector<Tensor> tensors;
+  std::string meta;
+  size_t next; // index of the tensor read next
+  bool is_mapped;
+
+public:
+  /*
+   * @brief Open a checkpoint and check its header
+   * @param map memory-map the file (POSIX); otherwise, or if mapping
+   * fails, it is read into memory with one read
+   * @param verify check the checksum of every payload
+   */
+  explicit Reader(const std::string &path, bool map = true,
+                  bool verify = false);
+
+  /*
+   * @brief Metadata text written with the checkpoint
+   */
+  const std::string &metadata() const { return meta; }
+
+  /*
+   * @brief Number of tensors in the checkpoint
+   */
+  size_t size() const { return tensors.size(); }
+
+  /*
+   * @brief Number of tensors not read yet
+   */
+  size_t remaining() const { return tensors.size() - next; }
+
+  /*
+   * @brief Next tensor; throws std::runtime_error if none is left
+   */
+  const Tensor &read();
+
+  /*
+   * @brief Whether the tensors point into a mapping of the file
+   */
+  bool mapped() const { return is_mapped; }
+
+  /*
+   * @brief Owner of the memory of the tensors, to keep it alive
+   */
+  std::shared_ptr<void> memory() const { return buffer; }
+};
+
+/*
+ * @brief Point a matrix at a tensor without copying it
+ * @return false (matrix unchanged) if the tensor is not stored as dtype
+ *
+ * The matrix is only valid while the tensor's memory is alive.
+ */
+template <typename T>
+bool view(const Tensor &tensor, DType dtype, Matrix<T> &matrix);
+
+/*
+ * @brief Copy a tensor into a matrix of its shape, converting its values
+ * to T (float or double) from any dtype
+ * @param padded pad the rows of matrix, whatever the tensor's stride
+ */
+template <typename T>
+void copy(const Tensor &tensor, Matrix<T> &matrix, bool padded);
+
+} // namespace checkpoint
+
+#endif // !CHECKPOINT_H
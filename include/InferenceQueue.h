@@ -0,0 +1,89 @@
+#ifndef INFERENCEQUEUE_H
+#define INFERENCEQUEUE_H
+
+#include "Matrix.h"
+#include "Memory.h"
+#include "SequentialModel.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/*
+ * @brief Dynamic micro-batching front end of a model for serving
+ * @tparam T scalar type of the model (float or double)
+ *
+ * Requests submitted from any number of threads are queued and coalesced
+ * by one worker thread into batches of up to max_batch samples. A batch is
+ * run as soon as it is full, or once its oldest request has waited
+ * max_wait, so the queueing delay of a request is bounded by max_wait plus
+ * the time of the batch in progress. Each batch is a single const
+ * predict() of the model, so the queue can share the model with other
+ * readers (see SequentialModel::predict(inputs, scratch)).
+ */
+template <typename T> class InferenceQueue {
+private:
+  struct Request {
+    vector<T> input;
+    std::promise<vector<T>> result;
+    std::chrono::steady_clock::time_point arrival;
+  };
+
+  const SequentialModel<T> &model;
+  size_t max_batch;                    // most requests per forward
+  std::chrono::microseconds max_wait;  // deadline of the oldest request
+  std::mutex mutex;                    // guards pending and stopping
+  std::condition_variable ready;       // signals new requests or shutdown
+  std::deque<Request> pending;         // requests not yet batched
+  bool stopping;                       // destructor called
+  vector<Request> running;             // requests of the current batch
+  Matrix<T> batch;                     // inputs of the current batch
+  Arena scratch;                       // activations of the current batch
+  std::thread worker;                  // started last, after every member
+
+  /*
+   * @brief Collect batches and fulfill their requests until stopped
+   */
+  void run();
+
+  /*
+   * @brief Run one forward for the requests in running
+   */
+  void runBatch();
+
+public:
+  /*
+   * @brief Start the batching worker
+   * @param model model to serve; must outlive the queue and not be trained
+   * while the queue is running
+   * @param max_batch largest number of requests per forward
+   * @param max_wait longest time the oldest request waits for a batch to
+   * fill before it is run anyway
+   */
+  InferenceQueue(const SequentialModel<T> &model, size_t max_batch,
+                 std::chrono::microseconds max_wait);
+
+  /*
+   * @brief Run the requests still queued, then stop the worker
+   */
+  ~InferenceQueue();
+
+  InferenceQueue(const InferenceQueue &) = delete;
+  InferenceQueue &operator=(const InferenceQueue &) = delete;
+
+  /*
+   * @brief Queue one prediction
+   * @param input input data (features) of one sample
+   * @return future output of the model; holds the exception if the
+   * prediction failed
+   */
+  std::future<vector<T>> submit(vector<T> input);
+};
+
+#endif // !INFERENCEQUEUE_H
@@ -0,0 +1,123 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+
+/*
+ * @brief Dense row-major matrix kept in one 64-byte aligned allocation
+ * @tparam T element type (instantiated for float and double, for int8_t
+ * and int32_t used by quantized layers and uint16_t for 16-bit weights)
+ *
+ * Rows may be padded so that every row starts on a 64-byte boundary
+ * (stride() >= cols()). Padding elements are always kept at zero, so whole
+ * buffers can be swept linearly with data() and storageSize(). Buffers are
+ * kept across resizes and copies that fit, so matrices reused for every
+ * batch stop allocating once they reach their largest shape.
+ *
+ * A view (see view()) refers to memory owned elsewhere, typically an Arena.
+ * Copies of a view own their buffer, and so does a view after a resize or
+ * a reshape to another shape.
+ */
+template <typename T> class Matrix {
+
+private:
+  T *storage;        // aligned buffer of n_rows * row_stride values
+  size_t n_rows;     // number of rows
+  size_t n_cols;     // number of used columns in each row
+  size_t row_stride; // distance between rows (leading dimension)
+  size_t capacity;   // number of values the buffer can hold (0 for views)
+  bool owned;        // the buffer is freed by this matrix
+
+  void allocate(size_t rows, size_t cols, bool padded);
+  void release();
+
+public:
+  static constexpr size_t alignment = 64; // alignment of buffer and rows
+
+  Matrix();
+
+  /*
+   * @brief Create a matrix filled with a value
+   * @param rows number of rows
+   * @param cols number of columns
+   * @param value initial value of every element
+   * @param padded pad rows so each one starts on a 64-byte boundary
+   */
+  Matrix(size_t rows, size_t cols, T value = T(), bool padded = false);
+
+  /*
+   * @brief Create a matrix over memory it does not own
+   * @param data buffer of rows * stride values, 64-byte aligned for the
+   * kernels; padding elements must be zero
+   */
+  static Matrix view(T *data, size_t rows, size_t cols, size_t stride);
+
+  /*
+   * @brief Row stride of a padded matrix with cols columns
+   */
+  static size_t paddedStride(size_t cols);
+
+  Matrix(const Matrix &other);
+  Matrix(Matrix &&other) noexcept;
+  Matrix &operator=(const Matrix &other);
+  Matrix &operator=(Matrix &&other) noexcept;
+  ~Matrix();
+
+  /*
+   * @brief Give the matrix a new shape, all values set to value
+   *
+   * The buffer is reused when the new shape fits in it.
+   */
+  void resize(size_t rows, size_t cols, T value = T(), bool padded = false);
+
+  /*
+   * @brief Give the matrix a new shape without initializing its values
+   *
+   * Meant for buffers that are fully overwritten next. Nothing is touched
+   * when the shape does not change; otherwise the buffer is reused when
+   * large enough and cleared so that the padding stays at zero.
+   */
+  void reshape(size_t rows, size_t cols, bool padded = false);
+
+  /*
+   * @brief Set every element (padding excluded) to value
+   */
+  void fill(T value);
+
+  /*
+   * @brief Copy values from a matrix of the same shape (strides may differ)
+   */
+  void assign(const Matrix &other);
+
+  T &operator()(size_t i, size_t j) { return storage[i * row_stride + j]; }
+  T operator()(size_t i, size_t j) const { return storage[i * row_stride + j]; }
+
+  T *row(size_t i) { return storage + i * row_stride; }
+  const T *row(size_t i) const { return storage + i * row_stride; }
+
+  T *data() { return storage; }
+  const T *data() const { return storage; }
+
+  size_t rows() const { return n_rows; }
+  size_t cols() const { return n_cols; }
+  size_t stride() const { return row_stride; }
+
+  /*
+   * @brief Number of elements in the buffer including row padding
+   */
+  size_t storageSize() const { return n_rows * row_stride; }
+
+  bool empty() const { return n_rows == 0 || n_cols == 0; }
+
+  /*
+   * @brief Bytes of heap memory held by the matrix (0 for views)
+   */
+  size_t allocatedBytes() const { return owned ? capacity * sizeof(T) : 0; }
+
+  /*
+   * @brief Whether the matrix refers to memory it does not own
+   */
+  bool isView() const { return !owned && storage != nullptr; }
+};
+
+#endif // !MATRIX_H
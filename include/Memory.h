@@ -0,0 +1,111 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <vector>
+
+// Aligned allocation shared by Matrix and Arena, with optional transparent
+// huge page backing for large buffers.
+namespace memory {
+
+constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+/*
+ * @brief Back buffers of at least huge_page_size bytes allocated from now
+ * on with transparent huge pages (Linux madvise; ignored elsewhere)
+ *
+ * Enable it before building layers so that their parameters get huge pages
+ * too; buffers allocated earlier keep their pages.
+ */
+void setHugePages(bool enabled);
+
+/*
+ * @brief Whether large buffers are backed with huge pages
+ */
+bool hugePages();
+
+/*
+ * @brief Allocate zeroed memory, released with std::free
+ * @param bytes size of the buffer
+ * @param alignment power of two alignment (at least sizeof(void *))
+ * @return buffer, or nullptr if bytes is 0; throws std::bad_alloc on failure
+ */
+void *allocate(size_t bytes, size_t alignment);
+
+} // namespace memory
+
+/*
+ * @brief Bump allocator for the transient tensors of one step
+ *
+ * Allocations are carved from one block and released all at once by
+ * reset(). When a step needs more than the block holds, extra blocks are
+ * chained and merged into a single larger block at the next reset, so after
+ * the first step every allocation is a pointer bump and reset() is O(1).
+ * Memory handed out stays valid until the next reset().
+ */
+class Arena {
+private:
+  struct Block {
+    char *data;  // 64-byte aligned buffer
+    size_t size; // bytes
+  };
+
+  std::vector<Block> blocks; // current block last
+  size_t offset;             // bytes used in the current block
+  size_t used_bytes;         // bytes handed out since the last reset
+  size_t peak_bytes;         // largest used_bytes seen
+
+  void addBlock(size_t bytes);
+
+public:
+  static constexpr size_t alignment = 64; // alignment of every allocation
+
+  /*
+   * @brief Create an arena
+   * @param initial_bytes size of the first block (0: allocate on first use)
+   */
+  explicit Arena(size_t initial_bytes = 0);
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /*
+   * @brief Get uninitialized storage for count values of T
+   */
+  template <typename T> T *allocate(size_t count) {
+    return static_cast<T *>(allocateBytes(count * sizeof(T)));
+  }
+
+  /*
+   * @brief Get uninitialized storage of the given size, 64-byte aligned
+   */
+  void *allocateBytes(size_t bytes);
+
+  /*
+   * @brief Release everything allocated since the last reset
+   */
+  void reset();
+
+  /*
+   * @brief Free every block, for when the next steps need less memory
+   */
+  void release();
+
+  /*
+   * @brief Bytes handed out since the last reset
+   */
+  size_t used() const { return used_bytes; }
+
+  /*
+   * @brief Most bytes handed out within one step so far
+   */
+  size_t peak() const { return peak_bytes; }
+
+  /*
+   * @brief Total size of the blocks owned by the arena
+   */
+  size_t capacity() const;
+};
+
+#endif // !MEMORY_H
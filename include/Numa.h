@@ -0,0 +1,67 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * NUMA topology and thread placement.
+ *
+ * Built with EASYLEARN_LIBNUMA (and -lnuma), libnuma is used; otherwise the
+ * topology is read from /sys on Linux. Elsewhere, or on a single-node
+ * machine, there is one node and pinning does nothing.
+ */
+namespace numa {
+
+/*
+ * @brief Number of NUMA nodes (1 if the machine is not NUMA or unknown)
+ */
+size_t nodes();
+
+/*
+ * @brief CPUs of a node
+ * @param node index below nodes()
+ */
+std::vector<int> cpus(size_t node);
+
+/*
+ * @brief CPUs the calling thread may run on: its affinity, as narrowed by
+ * taskset or a cpuset (empty if unknown, or not Linux)
+ */
+std::vector<int> allowedCpus();
+
+/*
+ * @brief Restrict the calling thread to the CPUs of a node, so the memory
+ * it touches first is allocated there
+ * @return false if the thread could not be pinned
+ */
+bool pinThread(size_t node);
+
+/*
+ * @brief Saves the CPUs the constructing thread may run on and restores
+ * exactly those when destroyed, undoing pinThread without dropping an
+ * affinity set before (taskset, cgroups, the application)
+ *
+ * Built on the thread it restores, which must also destroy it.
+ */
+class AffinityGuard {
+private:
+  std::vector<int> saved; // allowed CPUs, empty if they could not be read
+
+public:
+  AffinityGuard();
+  ~AffinityGuard();
+
+  AffinityGuard(const AffinityGuard &) = delete;
+  AffinityGuard &operator=(const AffinityGuard &) = delete;
+};
+
+/*
+ * @brief Node holding the page of an address
+ * @return node index, or -1 if unknown (page not touched, no NUMA support)
+ */
+int nodeOf(const void *address);
+
+} // namespace numa
+
+#endif // !NUMA_H
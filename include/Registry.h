@@ -0,0 +1,56 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "layers/Layer.h"
+#include "loss/Loss.h"
+#include "optimizers/Optimizer.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+/*
+ * @brief Factories of layers, losses and optimizers by type name, used to
+ * rebuild a model from an archive (see SequentialModel::load)
+ * @tparam T scalar type of the created objects (float or double)
+ *
+ * The built-in types (the dense layers, MSE and SGD) are registered from
+ * the start. Other types are registered once at startup under the name
+ * their typeName() returns, before loading archives that use them.
+ */
+template <typename T> class Registry {
+public:
+  /*
+   * @brief Create a layer of the given shape; its parameters are read from
+   * the archive next, so it should not initialize or allocate them (see
+   * ParameterInit::Deferred)
+   */
+  using LayerFactory =
+      std::function<std::unique_ptr<Layer<T>>(int input, int output)>;
+
+  using LossFactory = std::function<std::unique_ptr<Loss<T>>()>;
+
+  /*
+   * @brief Create an optimizer; its hyperparameters and state are restored
+   * with loadState next
+   */
+  using OptimizerFactory = std::function<std::unique_ptr<Optimizer<T>>()>;
+
+  /*
+   * @brief Register a type, replacing any factory of the same name
+   */
+  static void addLayer(const std::string &type, LayerFactory factory);
+  static void addLoss(const std::string &type, LossFactory factory);
+  static void addOptimizer(const std::string &type, OptimizerFactory factory);
+
+  /*
+   * @brief Create a registered type; throws std::invalid_argument for an
+   * unknown name
+   */
+  static std::unique_ptr<Layer<T>> createLayer(const std::string &type,
+                                               int input, int output);
+  static std::unique_ptr<Loss<T>> createLoss(const std::string &type);
+  static std::unique_ptr<Optimizer<T>>
+  createOptimizer(const std::string &type);
+};
+
+#endif // !REGISTRY_H
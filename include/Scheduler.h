@@ -0,0 +1,299 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class TaskGroup;
+
+/*
+ * @brief Work-stealing scheduler running parallel loops and task groups
+ *
+ * Every worker thread owns a deque of jobs: it pushes and pops at the back
+ * and idle workers steal from the front, so large pieces of work move and
+ * small ones stay in the cache of the thread that split them. Threads that
+ * are not workers (the caller of a training run, concurrent predictions)
+ * submit through a shared queue and run jobs themselves while they wait.
+ *
+ * A worker waiting for a nested loop keeps running jobs instead of
+ * blocking, so parallel paths can nest (a kernel inside a data-parallel
+ * shard) without adding threads: the machine never runs more than size()
+ * workers plus the external callers. Jobs must not block on each other.
+ */
+class Scheduler {
+public:
+  /*
+   * @brief Non-owning reference to a loop body called as body(a, b)
+   *
+   * Refers to the callable it is built from, which must outlive the call
+   * it is passed to; unlike std::function it never allocates.
+   */
+  class Task {
+  private:
+    const void *body;
+    void (*invoke)(const void *body, size_t a, size_t b);
+
+    friend class Scheduler;
+    friend class TaskGroup;
+
+  public:
+    template <typename F, typename = typename std::enable_if<!std::is_same<
+                              typename std::decay<F>::type, Task>::value>::type>
+    Task(const F &f)
+        : body(&f), invoke([](const void *body, size_t a, size_t b) {
+            (*static_cast<const F *>(body))(a, b);
+          }) {}
+
+    void operator()(size_t a, size_t b) const { invoke(body, a, b); }
+  };
+
+private:
+  /*
+   * @brief Range [begin, end) of a loop, split in halves until it is no
+   * larger than grain
+   */
+  struct Job {
+    const void *body;
+    void (*invoke)(const void *body, size_t begin, size_t end);
+    size_t begin;
+    size_t end;
+    size_t grain;
+    TaskGroup *group;
+  };
+
+  /*
+   * @brief Deque of jobs guarded by a mutex, in a ring buffer that only
+   * grows
+   */
+  class JobQueue {
+  private:
+    std::mutex mutex;
+    std::vector<Job> jobs;
+    size_t head;  // index of the front job
+    size_t count; // number of queued jobs
+
+  public:
+    JobQueue();
+    void pushBack(const Job &job);
+    bool popBack(Job &job);
+    bool popFront(Job &job);
+  };
+
+  std::vector<std::unique_ptr<JobQueue>> queues; // one per worker thread
+  JobQueue shared;                  // jobs queued by other threads
+  std::vector<std::thread> threads; // size() - 1 workers
+  std::atomic<size_t> queued;       // jobs in all queues
+  std::atomic<size_t> sleeping;     // workers waiting for a job
+  std::mutex sleep_mutex;           // guards waiting for a job
+  std::condition_variable wake;     // a job was queued, or stopping
+  std::atomic<bool> stopping;
+
+  /*
+   * @brief Index of the calling thread among the workers, or the number of
+   * workers if it is not one
+   */
+  size_t self() const;
+
+  /*
+   * @brief Queue a job on the deque of the calling worker, or the shared
+   * queue, and wake a sleeping worker
+   */
+  void push(const Job &job);
+
+  /*
+   * @brief Take a job: the back of the caller's deque first, then the
+   * front of the shared queue and of the other workers' deques
+   */
+  bool take(size_t worker, Job &job);
+
+  /*
+   * @brief Split a job down to its grain, queueing the upper halves, then
+   * run it and mark it done in its group
+   */
+  void execute(Job job);
+
+  /*
+   * @brief Run jobs until the group has none left
+   */
+  void join(TaskGroup &group);
+
+  /*
+   * @brief Run jobs, sleeping while there are none, until stopped
+   */
+  void run(size_t worker);
+
+  /*
+   * @brief Wake the workers to stop and join them
+   */
+  void stop();
+
+  friend class TaskGroup;
+
+public:
+  /*
+   * @brief Start the workers
+   * @param size number of threads including the caller (at least 1)
+   * @param pin pin each worker to one of the CPUs the caller may run on,
+   * in order, leaving the first to the caller (Linux; ignored elsewhere);
+   * throws std::system_error if a worker cannot be pinned
+   */
+  explicit Scheduler(size_t size, bool pin = false);
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /*
+   * @brief Number of threads including the caller
+   */
+  size_t size() const { return threads.size() + 1; }
+
+  /*
+   * @brief Run body(b, e) over ranges covering [begin, end) and wait
+   * @param grain largest range passed to body; ranges are halved down to
+   * it, so each range has at least grain / 2 items
+   * @param body loop body, called concurrently with disjoint ranges
+   *
+   * The first exception thrown by the body is rethrown once every range
+   * has run.
+   */
+  void parallelFor(size_t begin, size_t end, size_t grain, const Task &body);
+};
+
+/*
+ * @brief Set of tasks run on a scheduler and joined together
+ *
+ * Tasks are referenced, not copied: a task must be an lvalue that outlives
+ * wait().
+ */
+class TaskGroup {
+private:
+  Scheduler &scheduler;
+  std::atomic<size_t> pending; // jobs not yet finished
+  std::mutex mutex;            // guards error
+  std::exception_ptr error;    // first exception thrown by a task
+
+  /*
+   * @brief Queue a job of this group
+   */
+  void spawn(const Scheduler::Job &job);
+
+  /*
+   * @brief Record the exception being handled, if it is the first
+   */
+  void fail();
+
+  friend class Scheduler;
+
+public:
+  explicit TaskGroup(Scheduler &scheduler);
+
+  /*
+   * @brief Wait for the tasks still running (their errors are dropped)
+   */
+  ~TaskGroup();
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  /*
+   * @brief Run task() on the scheduler
+   */
+  template <typename F> void run(const F &task) {
+    spawn({&task,
+           [](const void *body, size_t, size_t) {
+             (*static_cast<const F *>(body))();
+           },
+           0, 1, 1, this});
+  }
+
+  /*
+   * @brief Temporaries would be gone before the task runs
+   */
+  template <typename F,
+            typename = typename std::enable_if<
+                !std::is_lvalue_reference<F>::value>::type>
+  void run(F &&task) = delete;
+
+  /*
+   * @brief Run body(begin, end) over ranges of [begin, end), as
+   * Scheduler::parallelFor, without waiting
+   */
+  void run(size_t begin, size_t end, size_t grain,
+           const Scheduler::Task &body);
+
+  /*
+   * @brief Wait for every task of the group, running queued jobs
+   * meanwhile, then rethrow the first exception of a task
+   */
+  void wait();
+};
+
+// Process-wide scheduler for parallelism inside layer kernels (intra-op)
+// and for the parallel trainers.
+namespace parallel {
+
+/*
+ * @brief Set the number of threads of the shared scheduler
+ * @param threads threads including the caller; 1 keeps kernels serial and
+ * 0 (the default) uses one per CPU the process may run on (its affinity)
+ *
+ * Takes effect on the next parallel call; must not be called while one
+ * is running.
+ */
+void setThreads(size_t threads);
+
+/*
+ * @brief Number of threads of the shared scheduler
+ */
+size_t threads();
+
+/*
+ * @brief Pin the worker threads of the shared scheduler to CPUs
+ *
+ * Takes effect on the next parallel call; must not be called while one
+ * is running.
+ */
+void setPinning(bool enabled);
+
+/*
+ * @brief Set the size of a kernel, in multiply-adds, below which it runs
+ * serially because waking threads would cost more than it saves
+ */
+void setMinWork(size_t multiply_adds);
+
+/*
+ * @brief Size of a kernel below which it runs serially
+ */
+size_t minWork();
+
+/*
+ * @brief Shared scheduler, started on first use
+ */
+Scheduler &scheduler();
+
+/*
+ * @brief Split [0, n) into ranges and run body(begin, end) for each on the
+ * shared scheduler
+ * @param n number of items (neurons, columns) to split
+ * @param work multiply-adds of the whole call, compared with minWork()
+ * @param body called with ranges whose begin is a multiple of align
+ * @param align granularity of the split, to keep vector loads whole
+ *
+ * Runs body(0, n) on the calling thread when the call is small or the
+ * scheduler has one thread. Calls from inside a parallel trainer are
+ * split too: their ranges go to idle workers.
+ */
+void forRange(size_t n, size_t work, const Scheduler::Task &body,
+              size_t align = 16);
+
+} // namespace parallel
+
+#endif // !SCHEDULER_H
@@ -1,37 +1,274 @@
 #ifndef SEQUENTIALMODEL_H
 #define SEQUENTIALMODEL_H
 
+#include "Matrix.h"
+#include "Memory.h"
+#include "ThreadPool.h"
 #include "layers/Layer.h"
+#include "layers/QuantizedLayer.h"
 #include "loss/Loss.h"
 #include "optimizers/Optimizer.h"
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
 
 using std::vector;
 
+/*
+ * @brief Accuracy and size of the int8 model compared to the original one
+ */
+template <typename T> struct QuantizationReport {
+  T loss;                 // loss of the original model
+  T quantized_loss;       // loss of the quantized model
+  T max_abs_error;        // largest output difference between the two
+  T mean_abs_error;       // mean output difference between the two
+  size_t bytes;           // parameter memory of the original model
+  size_t quantized_bytes; // parameter memory of the quantized model
+};
+
 /*
  * @brief Implements building a model from layers, training, and prediction
+ * @tparam T scalar type of the whole model (float or double)
  */
-class SequentialModel {
+template <typename T> class SequentialModel {
 private:
-  vector<std::unique_ptr<Layer>> layers;
-  std::unique_ptr<Loss> loss_func;
-  std::unique_ptr<Optimizer> optimizer;
+  vector<std::unique_ptr<Layer<T>>> layers;
+  std::unique_ptr<Loss<T>> loss_func;
+  std::unique_ptr<Optimizer<T>> optimizer;
+  vector<QuantizedLayer<T>> quantized_layers;
   int epochs;
+  bool fused_update; // apply the optimizer inside the layers' backward
+  bool training;     // layers keep gradients and what backward needs
+  Arena arena;         // transient tensors of one step, reset between steps
+  Matrix<T> workspace; // two ping-pong activation rows for predictInto
+
+  /*
+   * @brief Size the workspace for the widest layer output; again after
+   * every load, which may change the shapes of the layers
+   */
+  void planWorkspace();
+
+  /*
+   * @brief Print the average loss about ten times over the training run
+   * @param epoch current epoch
+   * @param loss summed loss of the epoch
+   * @param samples number of training samples
+   */
+  void reportProgress(int epoch, double loss, size_t samples) const;
+
+  /*
+   * @brief Forward a batch through all layers without copying activations
+   * @return output of the last layer (owned by that layer)
+   */
+  const Matrix<T> &forwardBatch(const Matrix<T> &inputs);
+
+  /*
+   * @brief Whether the optimizer update of a layer runs inside its backward
+   * @param learning_rate set to the fused step size
+   */
+  bool fusedUpdate(const Layer<T> &layer, T &learning_rate) const;
+
+  /*
+   * @brief Perform back propagation for the last predicted batch
+   */
+  void backwardBatch();
+
+  /*
+   * @brief Train on samples [begin, end) with shared-parameter updates
+   * @param activations one matrix per layer, for views of its outputs
+   * @param scratch arena of the calling worker
+   * @return loss summed over the samples
+   */
+  double trainShard(const vector<vector<T>> &inputs,
+                    const vector<vector<T>> &targets, size_t begin,
+                    size_t end, int batch_size, T learning_rate,
+                    SharedUpdate update, vector<Matrix<T>> &activations,
+                    Arena &scratch);
+
+  /*
+   * @brief Compute the gradients of samples [begin, end) of a batch
+   * @param model layers to run: layers, or a replica of them
+   * @param batch_rows number of samples of the whole batch, by which the
+   * gradients are averaged
+   * @param grads weight and bias gradients of layer i at 2 * i, 2 * i + 1
+   * @return loss summed over the samples
+   */
+  double shardGradients(const vector<std::unique_ptr<Layer<T>>> &model,
+                        const vector<vector<T>> &inputs,
+                        const vector<vector<T>> &targets, size_t begin,
+                        size_t end, size_t batch_rows,
+                        vector<Matrix<T>> &grads,
+                        vector<Matrix<T>> &activations, Arena &scratch);
+
+  /*
+   * @brief Forward a batch through layers [first, last)
+   * @param input input of layer first
+   * @param activations set to the outputs of the layers, at their index,
+   * as views into scratch
+   */
+  void forwardLayers(size_t first, size_t last, const Matrix<T> &input,
+                     vector<Matrix<T>> &activations, Arena &scratch) const;
+
+  /*
+   * @brief Compute the gradients of layers [first, last) for a batch, for
+   * the same layers as backwardBatch
+   * @param gradient gradient with respect to the outputs of layer last - 1
+   * @param activations outputs of every layer for the batch
+   * @param grads weight and bias gradients of layer i at 2 * i, 2 * i + 1
+   * @param accumulate add to grads instead of overwriting them
+   * @return gradient with respect to the inputs of layer first, or an
+   * empty matrix if no layer below needs it
+   */
+  Matrix<T> backwardLayers(size_t first, size_t last, Matrix<T> gradient,
+                           const vector<Matrix<T>> &activations,
+                           vector<Matrix<T>> &grads, bool accumulate,
+                           Arena &scratch) const;
 
 public:
-  SequentialModel(vector<std::unique_ptr<Layer>> layers,
-                  std::unique_ptr<Loss> loss_function,
-                  std::unique_ptr<Optimizer> optimizer, int total_epochs);
+  SequentialModel(vector<std::unique_ptr<Layer<T>>> layers,
+                  std::unique_ptr<Loss<T>> loss_function,
+                  std::unique_ptr<Optimizer<T>> optimizer, int total_epochs);
 
   /*
    * @brief Get the model's output (prediction)
    * @param input input data (features)
    * @return output value
    */
-  vector<double> predict(const vector<double> &input);
+  vector<T> predict(const vector<T> &input);
+
+  /*
+   * @brief Get the model's outputs for a batch of samples
+   * @param inputs input data (features), one sample per row
+   * @return output values, one sample per row
+   */
+  Matrix<T> predict(const Matrix<T> &inputs);
+
+  /*
+   * @brief Get the model's output for one sample into a caller buffer
+   * @param input input size of the first layer values
+   * @param output output size of the last layer values
+   *
+   * Activations alternate between two buffers sized at construction, so the
+   * call performs no heap allocation. Nothing is kept for backward().
+   */
+  void predictInto(const T *input, T *output);
+
+  /*
+   * @brief Get the model's outputs for a batch without touching its state
+   * @param inputs input data (features), one sample per row
+   * @param scratch caller-owned arena for the activations, reset by the call
+   * @return output values, one sample per row (a view into scratch, valid
+   * until its next reset)
+   *
+   * Const and reentrant: threads share one model by each passing its own
+   * scratch (e.g. a thread_local Arena), which stops allocating once it
+   * has grown to the largest batch. Must not overlap with training or
+   * parameter changes.
+   */
+  Matrix<T> predict(const Matrix<T> &inputs, Arena &scratch) const;
+
+  /*
+   * @brief Get the model's output for one sample without touching its state
+   * @param input input size of the first layer values
+   * @param output output size of the last layer values
+   * @param scratch caller-owned arena for the activations, reset by the call
+   */
+  void predictInto(const T *input, T *output, Arena &scratch) const;
+
+  /*
+   * @brief Get the number of inputs of the first layer
+   */
+  int getInputSize() const;
+
+  /*
+   * @brief Get the number of outputs of the last layer
+   */
+  int getOutputSize() const;
+
+  /*
+   * @brief Get the arena holding the transient tensors of a step
+   *
+   * Batches, activations and gradients of predict() and train() are taken
+   * from it and released together when the next step begins, so the arena
+   * keeps everything one step needed and peak() reports that size.
+   */
+  const Arena &stepArena() const { return arena; }
+
+  /*
+   * @brief Switch between training (default) and evaluation mode
+   * @param enabled false for inference only
+   *
+   * Evaluation mode frees the gradients, the tensors kept for backward and
+   * the training-sized arena; forward then caches nothing and train() and
+   * backward() throw. Switching back allocates the gradients again.
+   */
+  void setTraining(bool enabled);
+
+  /*
+   * @brief Whether the model is in training mode
+   */
+  bool isTraining() const { return training; }
+
+  /*
+   * @brief Get the memory held by the layers and the model's buffers
+   * @return parameter, gradient and activation bytes; activations include
+   * the step arena and the predictInto rows
+   */
+  MemoryUsage memoryUsage() const;
+
+  /*
+   * @brief Store the weights of every layer in the given format
+   * @param precision Full, or BFloat16 / Float16 to halve weight memory
+   *
+   * Activations and sums stay in T. Training continues to work: the
+   * optimizer keeps full-precision master weights for 16-bit layers.
+   */
+  void setWeightPrecision(WeightPrecision precision);
+
+  /*
+   * @brief Apply the optimizer inside each layer's backward pass
+   * @param enabled turn the fused update on or off
+   *
+   * Only plain updates (SGD) are fused; layers with 16-bit weights and other
+   * optimizers keep the separate step. Fused layers update their weights in
+   * the same pass that computes the gradient and do not keep weight
+   * gradients, which saves their memory and one sweep over the weights.
+   */
+  void setFusedUpdate(bool enabled);
+
+  /*
+   * @brief Build an int8 copy of the model for inference
+   * @param calibration_inputs sample inputs used to choose the input scale
+   * of each layer (should cover the range seen in production)
+   *
+   * The copy is not updated by further training; call quantize again.
+   */
+  void quantize(const vector<vector<T>> &calibration_inputs);
+
+  /*
+   * @brief Get the quantized model's output
+   * @param input input data (features)
+   * @return output value
+   */
+  vector<T> predictQuantized(const vector<T> &input);
+
+  /*
+   * @brief Get the quantized model's outputs for a batch of samples
+   * @param inputs input data (features), one sample per row
+   * @return output values, one sample per row
+   */
+  Matrix<T> predictQuantized(const Matrix<T> &inputs);
+
+  /*
+   * @brief Compare the quantized model with the original one
+   * @param inputs input data (features)
+   * @param targets reference output values
+   * @return losses, output differences and parameter sizes of both models
+   */
+  QuantizationReport<T> quantizationReport(const vector<vector<T>> &inputs,
+                                           const vector<vector<T>> &targets);
 
   /*
    * @brief Perform back propagation
@@ -42,11 +279,81 @@ public:
    * @brief Train the model
    * @param input input data (features)
    * @param target expected output data
-   * @param learning_rate learning rate
-   * @return error
+   * @param batch_size number of samples per gradient step
    */
-  void train(const vector<vector<double>> &inputs,
-             const vector<vector<double>> &targets);
+  void train(const vector<vector<T>> &inputs,
+             const vector<vector<T>> &targets, int batch_size = 1);
+
+  /*
+   * @brief Train the model with lock-free parallel SGD (Hogwild)
+   * @param inputs input data (features)
+   * @param targets reference output values
+   * @param threads number of workers, each training on its own contiguous
+   * shard of the samples; they run as tasks of the shared scheduler, at
+   * most parallel::threads() at a time
+   * @param batch_size number of samples per gradient step of a worker
+   * @param update how workers write to the shared parameters
+   *
+   * Workers keep activations and gradients in their own arenas and apply
+   * plain SGD steps straight to the shared weights without locks, so the
+   * optimizer must be SGD and the weights full precision. Epochs end with
+   * all workers joined, and losses are reported as by train().
+   */
+  void trainHogwild(const vector<vector<T>> &inputs,
+                    const vector<vector<T>> &targets, int threads,
+                    int batch_size = 1,
+                    SharedUpdate update = SharedUpdate::Racy);
+
+  /*
+   * @brief Train the model with synchronous data parallelism
+   * @param inputs input data (features)
+   * @param targets reference output values
+   * @param threads most shards computed at a time, on the shared
+   * scheduler
+   * @param batch_size number of samples per optimizer step
+   * @param shard_size number of samples per gradient shard
+   * @param numa_aware run the shards on threads pinned per NUMA node, each
+   * node reading its own replica of the parameters
+   *
+   * Each mini-batch is cut into shards of shard_size samples. Their
+   * gradients are computed in parallel into private buffers, then summed
+   * by a pairwise tree in a fixed order before a single optimizer step.
+   * Shards and the order of every addition depend only on batch_size and
+   * shard_size, so results are bit-identical for any thread count. Works
+   * with any optimizer and weight precision.
+   *
+   * With numa_aware, shard buffers are first touched on the node of the
+   * thread that fills them, and replicas are refreshed from the updated
+   * parameters after every step. Results are the same as without it; on a
+   * single-node machine only the pinning remains.
+   */
+  void trainDataParallel(const vector<vector<T>> &inputs,
+                         const vector<vector<T>> &targets, int threads,
+                         int batch_size, int shard_size = 16,
+                         bool numa_aware = false);
+
+  /*
+   * @brief Train the model with pipeline parallelism across layers
+   * @param inputs input data (features)
+   * @param targets reference output values
+   * @param stages number of threads, each running a contiguous group of
+   * layers of about equal parameter count
+   * @param batch_size number of samples per optimizer step
+   * @param micro_batch_size number of samples streamed through the stages
+   * at a time
+   * @param queue_capacity micro-batches a stage may run ahead of the next
+   *
+   * GPipe schedule: the micro-batches of a batch flow forward from stage
+   * to stage through bounded queues, then their gradients flow back in
+   * reverse order and accumulate in each stage. One optimizer step follows
+   * per batch. Each thread only touches the weights of its own layers,
+   * which stay in its cache when a group fits. Results do not depend on
+   * the number of stages. Works with any optimizer and weight precision.
+   */
+  void trainPipeline(const vector<vector<T>> &inputs,
+                     const vector<vector<T>> &targets, int stages,
+                     int batch_size, int micro_batch_size,
+                     int queue_capacity = 2);
 
   /*
    * @brief Perform one epoch of training
@@ -55,8 +362,8 @@ public:
    * @param learning_rate learning rate
    * @param verbose flag to output error information
    */
-  void train_epoch(const vector<vector<double>> &inputs,
-                   const vector<vector<double>> &targets, double learning_rate,
+  void train_epoch(const vector<vector<T>> &inputs,
+                   const vector<vector<T>> &targets, T learning_rate,
                    bool verbose = false);
 
   /*
@@ -68,6 +375,46 @@ public:
    * @brief Initialize each layers weights in model with downloaded parameters
    */
   void downloadParams();
+
+  /*
+   * @brief Save the parameters of every layer to one binary checkpoint
+   * @param path file to write, replaced only once it is complete
+   */
+  void saveCheckpoint(const std::string &path) const;
+
+  /*
+   * @brief Load a checkpoint written by saveCheckpoint into the layers
+   * @param map memory-map the file: parameters stored in the layers' own
+   * format are used in place, without parsing or copying
+   * @param verify check the checksum of every tensor, which reads the
+   * whole file
+   *
+   * Throws std::runtime_error, with the model unchanged, if the checkpoint
+   * does not fit the shapes of the layers.
+   */
+  void loadCheckpoint(const std::string &path, bool map = true,
+                      bool verify = false);
+
+  /*
+   * @brief Save the whole model to one archive: layer types, sizes and
+   * weight precisions, loss, epochs, optimizer hyperparameters and state,
+   * and every parameter
+   * @param path file to write, replaced only once it is complete
+   */
+  void save(const std::string &path) const;
+
+  /*
+   * @brief Build a model from an archive written by save
+   * @param map memory-map the file and use the parameters in place where
+   * the scalar type and weight precision match
+   * @param verify check the checksum of every tensor
+   *
+   * Layers, loss and optimizer are created through Registry<T> from their
+   * type names, so the caller does not rebuild the layer stack. Archives
+   * saved with the other scalar type are converted.
+   */
+  static std::unique_ptr<SequentialModel<T>>
+  load(const std::string &path, bool map = true, bool verify = false);
 };
 
 #endif // !SEQUENTIALMODEL_H
@@ -0,0 +1,96 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "Scheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * @brief Fixed set of threads running parallel loops
+ *
+ * The calling thread takes part in every loop as worker 0, so a pool of
+ * one thread runs loops inline without starting any thread.
+ *
+ * Every index of a loop gets a thread as soon as one is free, which is what
+ * tasks blocking on each other (pipeline stages) need. Compute loops go to
+ * the work-stealing Scheduler instead, which shares its threads across
+ * nested loops.
+ */
+class ThreadPool {
+public:
+  using Task = Scheduler::Task;
+
+private:
+  std::vector<std::thread> threads; // workers 1 .. size() - 1
+  std::mutex mutex;                 // guards the fields below
+  std::condition_variable start;    // a loop was posted, or stopping
+  std::condition_variable done;     // the last worker left the loop
+  const Task *task;                 // body of the current loop
+  size_t count;                     // number of indices of the loop
+  bool each;                        // every worker runs its own index
+  std::atomic<size_t> next;         // next index to hand out
+  size_t busy;                      // workers still in the loop
+  size_t generation;                // number of loops posted
+  bool stopping;                    // destructor called
+  std::exception_ptr error;         // first exception thrown by the loop
+
+  /*
+   * @brief Run indices of the current loop until none is left
+   */
+  void work(size_t worker);
+
+  /*
+   * @brief Wait for loops and take part in them until stopped
+   */
+  void run(size_t worker);
+
+  /*
+   * @brief Start a loop, take part in it and wait for its end
+   * @param on_each run task(worker, worker) on every thread instead of
+   * handing out indices
+   */
+  void post(size_t count, const Task &task, bool on_each);
+
+public:
+  /*
+   * @brief Start the workers
+   * @param size number of threads including the caller (at least 1)
+   */
+  explicit ThreadPool(size_t size);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /*
+   * @brief Number of threads including the caller
+   */
+  size_t size() const { return threads.size() + 1; }
+
+  /*
+   * @brief Run task(index, worker) for every index in [0, count) and wait
+   * @param count number of indices
+   * @param task loop body; worker < size() identifies the running thread,
+   * for per-thread buffers
+   *
+   * Indices are handed out one at a time to whichever worker is free, so
+   * a task must not depend on which worker runs it. The first exception
+   * thrown by a task is rethrown once the loop is over.
+   */
+  void parallelFor(size_t count, const Task &task);
+
+  /*
+   * @brief Run task(worker, worker) once on every thread and wait
+   *
+   * For per-thread setup and for work bound to a thread, such as memory
+   * it first touched on its NUMA node. Exceptions as for parallelFor.
+   */
+  void runOnEach(const Task &task);
+};
+
+#endif // !THREADPOOL_H
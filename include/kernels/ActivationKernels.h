@@ -0,0 +1,47 @@
+#ifndef ACTIVATIONKERNELS_H
+#define ACTIVATIONKERNELS_H
+
+#include "Cpu.h"
+#include <cstddef>
+
+namespace kernels {
+
+/*
+ * @brief Element-wise activation kernels compiled for one instruction set
+ * @tparam T element type (float or double)
+ *
+ * Forward kernels map n values of z to out. Derivative kernels apply the
+ * chain rule: out = grad * f'(...), taking z for ReLU and leaky ReLU and
+ * the activation output y for sigmoid and tanh. Output buffers may alias
+ * inputs. Leaky ReLU uses the slope activation::leaky_relu_slope.
+ *
+ * fast_sigmoid and fast_tanh are exp-free approximations with an absolute
+ * error below 3.7e-5 and 7.3e-5 respectively (see activation::Mode).
+ */
+template <typename T> struct ActivationKernels {
+  void (*relu)(const T *z, T *out, size_t n);
+  void (*relu_derivative)(const T *z, const T *grad, T *out, size_t n);
+  void (*leaky_relu)(const T *z, T *out, size_t n);
+  void (*leaky_relu_derivative)(const T *z, const T *grad, T *out, size_t n);
+  void (*sigmoid)(const T *z, T *out, size_t n);
+  void (*sigmoid_derivative)(const T *y, const T *grad, T *out, size_t n);
+  void (*tanh)(const T *z, T *out, size_t n);
+  void (*tanh_derivative)(const T *y, const T *grad, T *out, size_t n);
+  void (*fast_sigmoid)(const T *z, T *out, size_t n);
+  void (*fast_tanh)(const T *z, T *out, size_t n);
+};
+
+/*
+ * @brief Get the activation kernels for the best instruction set of this CPU
+ */
+template <typename T> const ActivationKernels<T> &activationKernels();
+
+/*
+ * @brief Get the activation kernels for a given instruction set
+ * @param isa instruction set; must be supported by the CPU
+ */
+template <typename T> const ActivationKernels<T> &activationKernels(Isa isa);
+
+} // namespace kernels
+
+#endif // !ACTIVATIONKERNELS_H
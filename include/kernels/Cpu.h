@@ -0,0 +1,36 @@
+#ifndef CPU_H
+#define CPU_H
+
+// Build helpers for kernels compiled for several instruction sets in one
+// binary; the best variant is picked at run time with detectedIsa()
+#if defined(__x86_64__) || defined(__i386__)
+#define EASYLEARN_X86 1
+#define EASYLEARN_TARGET(isa) __attribute__((target(isa)))
+#else
+#define EASYLEARN_X86 0
+#define EASYLEARN_TARGET(isa)
+#endif
+
+#define EASYLEARN_INLINE inline __attribute__((always_inline))
+
+namespace kernels {
+
+/*
+ * @brief Instruction set levels with dedicated kernel variants
+ */
+enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+/*
+ * @brief Get the best instruction set supported by this CPU
+ * @return instruction set level (queried once via cpuid)
+ */
+Isa detectedIsa();
+
+/*
+ * @brief Get a printable name of an instruction set level
+ */
+const char *isaName(Isa isa);
+
+} // namespace kernels
+
+#endif // !CPU_H
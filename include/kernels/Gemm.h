@@ -0,0 +1,91 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "Half.h"
+#include <cstddef>
+#include <cstdint>
+
+// Dense linear algebra kernels used by the layers. All matrices are
+// row-major and described by a pointer and a leading dimension (distance
+// between rows), so Matrix::data() and Matrix::stride() can be passed as is.
+// The kernels are instantiated for float and double.
+namespace kernels {
+
+enum class Transpose { No, Yes };
+
+/*
+ * @brief General matrix multiplication C = alpha * op(A) * op(B) + beta * C
+ * @param trans_a use A transposed (A is stored k x m) or not (m x k)
+ * @param trans_b use B transposed (B is stored n x k) or not (k x n)
+ * @param m number of rows of op(A) and C
+ * @param n number of columns of op(B) and C
+ * @param k number of columns of op(A) and rows of op(B)
+ * @param beta scale of the previous C values; with beta == 0 C is not read
+ *
+ * Transposition is handled while packing operands into cache-sized blocks,
+ * so no transposed copy of A or B is ever materialized. Calls with m == 1
+ * are routed to gemv and k == 1 to a rank-1 update.
+ */
+template <typename T>
+void gemm(Transpose trans_a, Transpose trans_b, size_t m, size_t n, size_t k,
+          T alpha, const T *a, size_t lda, const T *b, size_t ldb, T beta,
+          T *c, size_t ldc);
+
+/*
+ * @brief gemm with B stored as 16-bit floating point values
+ * @param b_format encoding of B (bfloat16 or float16)
+ *
+ * B is widened to T in slices that stay in L2 right before they are
+ * multiplied, so only the 16-bit copy is read from memory. Products are
+ * accumulated in T.
+ */
+template <typename T>
+void gemm(Transpose trans_a, Transpose trans_b, size_t m, size_t n, size_t k,
+          T alpha, const T *a, size_t lda, const uint16_t *b,
+          HalfFormat b_format, size_t ldb, T beta, T *c, size_t ldc);
+
+/*
+ * @brief Matrix-vector product y = alpha * op(A) * x + beta * y
+ * @param trans use A transposed or not
+ * @param m number of rows of A (as stored)
+ * @param n number of columns of A (as stored)
+ * @param beta scale of the previous y values; with beta == 0 y is not read
+ */
+template <typename T>
+void gemv(Transpose trans, size_t m, size_t n, T alpha, const T *a, size_t lda,
+          const T *x, T beta, T *y);
+
+/*
+ * @brief Scaled vector addition y = alpha * x + y
+ * @param n number of values of x and y
+ *
+ * Used by optimizers to update parameter buffers in place.
+ */
+template <typename T> void axpy(size_t n, T alpha, const T *x, T *y);
+
+/*
+ * @brief Scaled vector addition y = alpha * x + y in which every element of
+ * y is updated by a relaxed atomic read-modify-write
+ * @param n number of values of x and y
+ *
+ * For parameters shared by concurrent trainers; zero values of x are
+ * skipped, so sparse gradients touch only the values they change.
+ */
+template <typename T> void atomicAxpy(size_t n, T alpha, const T *x, T *y);
+
+/*
+ * @brief Integer matrix product C = A * B^T with 32-bit accumulation
+ * @param m number of rows of A and C
+ * @param n number of rows of B and columns of C
+ * @param k number of columns of A and B
+ *
+ * Both operands are row-major int8 with rows of k values, as produced by
+ * quantizing a batch of inputs (A) and a weight matrix (B). Inputs should
+ * stay within [-127, 127]; sums are exact for k up to 2^17.
+ */
+void gemmInt8(size_t m, size_t n, size_t k, const int8_t *a, size_t lda,
+              const int8_t *b, size_t ldb, int32_t *c, size_t ldc);
+
+} // namespace kernels
+
+#endif // !GEMM_H
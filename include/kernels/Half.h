@@ -0,0 +1,47 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Conversions between float/double and 16-bit floating point formats kept
+// as raw uint16_t bits. Narrowing rounds to nearest even. Bulk conversions
+// use F16C / AVX-512 (BF16) instructions when the CPU has them and a
+// software fallback otherwise.
+namespace kernels {
+
+/*
+ * @brief 16-bit floating point formats
+ *
+ * BFloat16 keeps the float exponent range with an 8-bit significand;
+ * Float16 (IEEE binary16) has an 11-bit significand but a maximum of 65504.
+ */
+enum class HalfFormat { BFloat16, Float16 };
+
+/*
+ * @brief Convert one 16-bit value to float
+ */
+float halfToFloat(uint16_t value, HalfFormat format);
+
+/*
+ * @brief Round one float to the nearest 16-bit value
+ */
+uint16_t floatToHalf(float value, HalfFormat format);
+
+/*
+ * @brief Convert n 16-bit values to T (float or double)
+ */
+template <typename T>
+void widenHalf(const uint16_t *in, T *out, size_t n, HalfFormat format);
+
+/*
+ * @brief Round n values of T (float or double) to 16-bit values
+ *
+ * double inputs are rounded to float first.
+ */
+template <typename T>
+void narrowToHalf(const T *in, uint16_t *out, size_t n, HalfFormat format);
+
+} // namespace kernels
+
+#endif // !HALF_H
@@ -0,0 +1,130 @@
+#ifndef ACTIVATIONPOLICY_H
+#define ACTIVATIONPOLICY_H
+
+#include "../Activation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Activation policies of DenseLayer. A policy is a set of static functions
+// resolved at compile time:
+//   name                        layer name used in error messages
+//   linear                      f is the identity (backward skips f')
+//   stddev(inputs, outputs)     standard deviation of initial weights
+//   apply(z, out, n)            out = f(z); out may alias z
+//   derivative(y, grad, out, n) out = grad * f'(z), computed from y = f(z)
+// Derivatives only need the layer output, so layers do not keep z.
+namespace activation {
+
+/*
+ * @brief Rectified linear unit with He initialization
+ */
+struct ReLU {
+  static constexpr const char *name = "ReLU";
+  static constexpr bool linear = false;
+
+  static double stddev(int inputs, int) { return std::sqrt(2.0 / inputs); }
+
+  template <typename T> static void apply(const T *z, T *out, size_t n) {
+    relu(z, out, n);
+  }
+
+  // y > 0 exactly where z > 0
+  template <typename T>
+  static void derivative(const T *y, const T *grad, T *out, size_t n) {
+    relu_derivative(y, grad, out, n);
+  }
+};
+
+/*
+ * @brief ReLU with slope leaky_relu_slope for negative inputs, with He
+ * initialization adjusted for that slope
+ */
+struct LeakyReLU {
+  static constexpr const char *name = "LeakyReLU";
+  static constexpr bool linear = false;
+
+  static double stddev(int inputs, int) {
+    return std::sqrt(2.0 / ((1.0 + leaky_relu_slope * leaky_relu_slope) *
+                            inputs));
+  }
+
+  template <typename T> static void apply(const T *z, T *out, size_t n) {
+    leaky_relu(z, out, n);
+  }
+
+  // the slope is positive, so y keeps the sign of z
+  template <typename T>
+  static void derivative(const T *y, const T *grad, T *out, size_t n) {
+    leaky_relu_derivative(y, grad, out, n);
+  }
+};
+
+/*
+ * @brief Logistic function with Xavier/Glorot initialization
+ */
+struct Sigmoid {
+  static constexpr const char *name = "Sigmoid";
+  static constexpr bool linear = false;
+
+  static double stddev(int inputs, int outputs) {
+    return std::sqrt(2.0 / (inputs + outputs));
+  }
+
+  template <typename T> static void apply(const T *z, T *out, size_t n) {
+    sigmoid(z, out, n);
+  }
+
+  template <typename T>
+  static void derivative(const T *y, const T *grad, T *out, size_t n) {
+    sigmoid_derivative(y, grad, out, n);
+  }
+};
+
+/*
+ * @brief Hyperbolic tangent with Xavier/Glorot initialization
+ */
+struct Tanh {
+  static constexpr const char *name = "Tanh";
+  static constexpr bool linear = false;
+
+  static double stddev(int inputs, int outputs) {
+    return std::sqrt(2.0 / (inputs + outputs));
+  }
+
+  template <typename T> static void apply(const T *z, T *out, size_t n) {
+    tanh(z, out, n);
+  }
+
+  template <typename T>
+  static void derivative(const T *y, const T *grad, T *out, size_t n) {
+    tanh_derivative(y, grad, out, n);
+  }
+};
+
+/*
+ * @brief Identity (linear output layer) with Xavier/Glorot initialization
+ */
+struct Identity {
+  static constexpr const char *name = "Linear";
+  static constexpr bool linear = true;
+
+  static double stddev(int inputs, int outputs) {
+    return std::sqrt(2.0 / (inputs + outputs));
+  }
+
+  template <typename T> static void apply(const T *z, T *out, size_t n) {
+    if (out != z)
+      std::copy(z, z + n, out);
+  }
+
+  template <typename T>
+  static void derivative(const T *, const T *grad, T *out, size_t n) {
+    if (out != grad)
+      std::copy(grad, grad + n, out);
+  }
+};
+
+} // namespace activation
+
+#endif // !ACTIVATIONPOLICY_H
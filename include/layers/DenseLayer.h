@@ -0,0 +1,375 @@
+#ifndef DENSELAYER_H
+#define DENSELAYER_H
+
+#include "../Matrix.h"
+#include "ActivationPolicy.h"
+#include "Layer.h"
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using std::vector;
+
+/*
+ * @brief Fully connected layer y = f(x * W^T + b)
+ * @tparam T scalar type (float or double)
+ * @tparam Activation activation policy f (see ActivationPolicy.h)
+ *
+ * The activation is applied as the epilogue of the matrix product, on
+ * blocks of rows that are still in L2, and its derivative is taken from the
+ * output, so no separate weighted-sum buffer is kept.
+ */
+template <typename T, typename Activation>
+class DenseLayer : public Layer<T> {
+
+private:
+  Matrix<T> weights;                // weights for each input of neuron
+  Matrix<uint16_t> half_weights;    // weights in 16-bit storage
+  WeightPrecision weight_precision; // storage format of weights
+  uint64_t weight_version;          // see Layer::weightVersion
+  Matrix<T> weight_grads;           // gradient with respect to weights
+  Matrix<T> biases;                 // biases for each neuron
+  Matrix<T> bias_grads;             // gradients with respect to biases
+  Matrix<T> last_input;             // last input data
+  Matrix<T> last_output;            // last output data
+  Matrix<T> delta;                  // gradient with respect to z
+  Matrix<T> input_grads;            // gradient with respect to the inputs
+  int input_size;                   // size of input data
+  int output_size;                  // number of neurons in layer
+  std::string config_name;          // path of file to save weights
+  std::shared_ptr<void> mapping;    // checkpoint memory viewed by the
+                                    // parameters, or null
+  Arena *arena;                     // source of transient tensors, or null
+  bool training;                    // keep what backward needs
+
+  /*
+   * @brief Shape a transient buffer, taken from the arena if there is one
+   */
+  void scratch(Matrix<T> &buffer, size_t rows, size_t cols);
+
+  /*
+   * @brief Throw std::runtime_error if stored weights and biases do not fit
+   * the layer's shape
+   */
+  void checkTensors(const checkpoint::Tensor &stored_weights,
+                    const checkpoint::Tensor &stored_biases) const;
+
+  /*
+   * @brief Allocate the weight and bias gradients
+   */
+  void allocateGrads();
+
+  /*
+   * @brief Throw std::logic_error if the parameters were deferred (see
+   * ParameterInit) and have not been loaded yet
+   */
+  void requireParameters() const;
+
+  /*
+   * @brief Accumulate x * W^T onto z for a block of rows and the neurons
+   * [first, last)
+   */
+  void multiplyWeights(size_t rows, size_t first, size_t last, const T *x,
+                       size_t ldx, T *z, size_t ldz) const;
+
+  /*
+   * @brief Compute y = f(x * W^T + b) for a block of rows and the neurons
+   * [first, last)
+   */
+  void forwardBlock(size_t rows, size_t first, size_t last, const T *x,
+                    size_t ldx, T *y, size_t ldy) const;
+
+  /*
+   * @brief Compute the z gradients and the bias gradients of a batch
+   * @return z gradients: delta, or output_gradient for the identity
+   */
+  const Matrix<T> &zGradient(const Matrix<T> &output_gradient);
+
+  /*
+   * @brief Gradient with respect to the inputs, input_grads = delta * W
+   */
+  void inputGradient(const Matrix<T> &dz);
+
+  /*
+   * @brief Gradient with respect to the inputs into a caller matrix
+   */
+  void inputGradientInto(const Matrix<T> &dz, Matrix<T> &dx) const;
+
+  /*
+   * @brief Weight gradients of a batch, dw = alpha * dz^T * x + beta * dw
+   */
+  void weightGradient(const Matrix<T> &dz, const Matrix<T> &x, T alpha,
+                      T beta, T *dw, size_t ldw) const;
+
+  /*
+   * @brief Z gradients of a batch from caller buffers, with their sums over
+   * the batch (bias gradients) written to db
+   * @return z gradients (a view into scratch, or of output_gradient)
+   */
+  Matrix<T> zGradientInto(const Matrix<T> &outputs,
+                          const Matrix<T> &output_gradient, T *db,
+                          Arena &scratch) const;
+
+  /*
+   * @brief Empty layer in evaluation mode, filled by replicate
+   */
+  DenseLayer();
+
+public:
+  /*
+   * @param init Random for He or Xavier/Glorot initialization (depending on
+   * the activation); Deferred when the parameters are loaded next
+   */
+  DenseLayer(int input, int neurons, std::string file_name,
+             ParameterInit init = ParameterInit::Random);
+
+  /*
+   * @brief Perform forward propagation
+   * @param input output data (axon signals) from previous neurons
+   * @return output data of this layer
+   */
+  vector<T> forward(const vector<T> &input) override;
+
+  /*
+   * @brief Perform backward propagation (adjust weights)
+   * @param output_grads gradients from previous layers
+   * @param learning_rate learning rate
+   * @return gradient
+   */
+  vector<T> backward(const vector<T> &output_gradient) override;
+
+  /*
+   * @brief Perform forward propagation for a batch of samples
+   * @param inputs batch of input data, one sample per row
+   * @return output data of this layer, one sample per row
+   */
+  const Matrix<T> &forward(const Matrix<T> &inputs) override;
+
+  /*
+   * @brief Take outputs and gradients from an arena (nullptr: owned buffers)
+   */
+  void setArena(Arena *arena) override;
+
+  /*
+   * @brief Switch between training and evaluation (inference only)
+   */
+  void setTraining(bool training) override;
+
+  /*
+   * @brief Get the memory held by the layer (arena views not included)
+   */
+  MemoryUsage memoryUsage() const override;
+
+  /*
+   * @brief Compute the output of one sample into a caller buffer
+   * @param input getInputSize() values
+   * @param output getOutputSize() values
+   */
+  void forwardInto(const T *input, T *output) const override;
+
+  /*
+   * @brief Compute the outputs of a batch into a caller matrix
+   * @param inputs batch of input data, one sample per row
+   * @param outputs inputs.rows() x getOutputSize() matrix, overwritten
+   */
+  void forwardInto(const Matrix<T> &inputs, Matrix<T> &outputs) const override;
+
+  /*
+   * @brief Perform backward propagation for the last forwarded batch
+   * @param output_grads gradients from previous layers, one sample per row
+   * @return gradient with respect to the inputs, one sample per row
+   */
+  const Matrix<T> &backward(const Matrix<T> &output_gradient) override;
+
+  /*
+   * @brief Backward propagation fused with a plain gradient descent update
+   * @param output_grads gradients from previous layers
+   * @param learning_rate step size of the update
+   * @return gradient
+   */
+  vector<T> backwardAndUpdate(const vector<T> &output_gradient,
+                              T learning_rate) override;
+
+  /*
+   * @brief Backward propagation fused with a plain gradient descent update
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param learning_rate step size of the update
+   * @return gradient with respect to the inputs, one sample per row
+   */
+  const Matrix<T> &backwardAndUpdate(const Matrix<T> &output_gradient,
+                                     T learning_rate) override;
+
+  /*
+   * @brief Backward propagation of a batch forwarded with forwardInto,
+   * applying the SGD update straight to the shared parameters
+   * @param inputs inputs of the batch
+   * @param outputs outputs forwardInto computed for inputs
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param input_grads set to the gradient with respect to the inputs, or
+   * nullptr if not needed
+   * @param learning_rate step size of the update
+   * @param update how the update is written to the parameters
+   * @param scratch arena for the temporaries of the call
+   */
+  void backwardAndUpdateInto(const Matrix<T> &inputs, const Matrix<T> &outputs,
+                             const Matrix<T> &output_gradient,
+                             Matrix<T> *input_gradient, T learning_rate,
+                             SharedUpdate update, Arena &scratch) override;
+
+  /*
+   * @brief Backward propagation of a batch forwarded with forwardInto, into
+   * caller gradient buffers
+   * @param inputs inputs of the batch
+   * @param outputs outputs forwardInto computed for inputs
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param input_grads set to the gradient with respect to the inputs, or
+   * nullptr if not needed
+   * @param weight_grads set to the weight gradients
+   * @param bias_grads set to the bias gradients
+   * @param scratch arena for the temporaries of the call
+   */
+  void backwardInto(const Matrix<T> &inputs, const Matrix<T> &outputs,
+                    const Matrix<T> &output_gradient,
+                    Matrix<T> *input_gradient, Matrix<T> &weight_gradient,
+                    Matrix<T> &bias_gradient, Arena &scratch) const override;
+
+  /*
+   * @brief Apply the layer's activation function to pre-activation values
+   * @param z weighted sums
+   * @param out output buffer (may alias z)
+   * @param n number of values
+   */
+  void applyActivation(const T *z, T *out, size_t n) const override;
+
+  /*
+   * @brief Save weights to a file, tagged with the precision of T
+   */
+  void saveParams() override;
+
+  /*
+   * @brief Initialize weights with download parameters form a file
+   *
+   * Throws std::runtime_error if the file cannot be opened or parsed.
+   */
+  void downloadParams() override;
+
+  /*
+   * @brief Add the weights (in their storage format) and biases to a
+   * checkpoint
+   */
+  void writeParams(checkpoint::Writer &writer) const override;
+
+  /*
+   * @brief Take the weights and biases from the next two tensors of a
+   * checkpoint, in place when they are stored in the layer's format
+   */
+  void readParams(checkpoint::Reader &reader) override;
+
+  /*
+   * @brief Read the next two tensors and check they fit the layer's shape
+   */
+  void checkParams(checkpoint::Reader &reader) const override;
+
+  /*
+   * @brief Name of the activation followed by "Layer", as the aliases below
+   */
+  std::string typeName() const override;
+
+  /*
+   * @brief Get weight values in the layer
+   * @return weights (widened to T if stored in 16 bits)
+   */
+  Matrix<T> getWeights() const override;
+
+  /*
+   * @brief Get bias values in the layer
+   * @return biases (single row matrix)
+   */
+  Matrix<T> getBiases() const override;
+
+  /*
+   * @brief Get weight gradient values of the layer
+   * @return weight gradients
+   */
+  Matrix<T> &getWeightGrads() override;
+
+  /*
+   * @brief Get bias gradient values of the layer
+   * @return bias gradients
+   */
+  Matrix<T> &getBiasGrads() override;
+
+  /*
+   * @brief Get the number of parameter tensors (weights and biases)
+   */
+  size_t parameterCount() const override;
+
+  /*
+   * @brief Get a view of the weights (index 0) or biases (index 1) and
+   * their gradients
+   */
+  ParameterView<T> parameter(size_t index) override;
+
+  /*
+   * @brief Set new values for weights
+   * @param new_weights new values of weights (rounded if stored in 16 bits)
+   */
+  void setWeights(const Matrix<T> &new_weights) override;
+
+  /*
+   * @brief Set new values for biases
+   * @param new_biases new values of biases
+   */
+  void setBiases(const Matrix<T> &new_biases) override;
+
+  /*
+   * @brief Change the storage format of the weights
+   * @param precision new format; converting to 16 bits rounds the weights
+   */
+  void setWeightPrecision(WeightPrecision precision) override;
+
+  /*
+   * @brief Get the storage format of the weights
+   */
+  WeightPrecision getWeightPrecision() const override;
+
+  /*
+   * @brief Version of the weights, changed by every write through the
+   * layer's methods
+   */
+  uint64_t weightVersion() const override;
+
+  /*
+   * @brief Get the number of input connections
+   * @return number of input connections
+   */
+  int getInputSize() const override;
+
+  /*
+   * @brief Get the number of output connections
+   * @return number of output connections
+   */
+  int getOutputSize() const override;
+
+  /*
+   * @brief Copy the parameters into a new layer in evaluation mode
+   */
+  std::unique_ptr<Layer<T>> replicate() const override;
+
+  /*
+   * @brief Overwrite the parameters with those of a DenseLayer of the same
+   * activation, shape and weight precision
+   */
+  void copyParameters(const Layer<T> &source) override;
+};
+
+template <typename T> using ReLULayer = DenseLayer<T, activation::ReLU>;
+template <typename T>
+using LeakyReLULayer = DenseLayer<T, activation::LeakyReLU>;
+template <typename T> using SigmoidLayer = DenseLayer<T, activation::Sigmoid>;
+template <typename T> using TanhLayer = DenseLayer<T, activation::Tanh>;
+template <typename T> using LinearLayer = DenseLayer<T, activation::Identity>;
+
+#endif // !DENSELAYER_H
@@ -0,0 +1,53 @@
+#ifndef HALFWEIGHTS_H
+#define HALFWEIGHTS_H
+
+#include "../Matrix.h"
+#include "../kernels/Half.h"
+#include "Layer.h"
+#include <cstdint>
+
+/*
+ * @brief 16-bit format used for a weight precision other than Full
+ */
+inline kernels::HalfFormat halfFormat(WeightPrecision precision) {
+  return precision == WeightPrecision::BFloat16 ? kernels::HalfFormat::BFloat16
+                                                : kernels::HalfFormat::Float16;
+}
+
+/*
+ * @brief Round weights to 16-bit storage (rows padded like the weights)
+ * @param weights weights in full precision
+ * @param precision BFloat16 or Float16
+ * @param encoded destination, resized to the shape of weights
+ */
+template <typename T>
+void encodeWeights(const Matrix<T> &weights, WeightPrecision precision,
+                   Matrix<uint16_t> &encoded) {
+  if (encoded.rows() != weights.rows() || encoded.cols() != weights.cols())
+    encoded.resize(weights.rows(), weights.cols(), 0, true);
+
+  for (size_t i = 0; i < weights.rows(); i++) {
+    kernels::narrowToHalf(weights.row(i), encoded.row(i), weights.cols(),
+                          halfFormat(precision));
+  }
+}
+
+/*
+ * @brief Widen 16-bit weights back to T
+ * @param encoded weights in 16-bit storage
+ * @param precision BFloat16 or Float16
+ * @return weights with padded rows
+ */
+template <typename T>
+Matrix<T> decodeWeights(const Matrix<uint16_t> &encoded,
+                        WeightPrecision precision) {
+  Matrix<T> weights(encoded.rows(), encoded.cols(), T(), true);
+
+  for (size_t i = 0; i < encoded.rows(); i++) {
+    kernels::widenHalf(encoded.row(i), weights.row(i), encoded.cols(),
+                       halfFormat(precision));
+  }
+  return weights;
+}
+
+#endif // !HALFWEIGHTS_H
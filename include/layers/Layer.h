@@ -1,14 +1,91 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include "../Checkpoint.h"
+#include "../Matrix.h"
+#include "../Memory.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 using std::vector;
 
+/*
+ * @brief Name of a scalar type as recorded in parameter files
+ */
+template <typename T> const char *dtypeName();
+template <> inline const char *dtypeName<float>() { return "float32"; }
+template <> inline const char *dtypeName<double>() { return "float64"; }
+
+/*
+ * @brief Next value for Layer::weightVersion, unique in the process so a
+ * layer never takes up the version of a destroyed one
+ */
+inline uint64_t nextWeightVersion() {
+  static std::atomic<uint64_t> last(0);
+  return ++last;
+}
+
+/*
+ * @brief Storage format of layer weights
+ *
+ * BFloat16 and Float16 keep weights in 16 bits, halving their memory and
+ * bandwidth. They are widened on the fly and products accumulate in the
+ * layer's scalar type; biases and gradients always stay full precision.
+ */
+enum class WeightPrecision { Full, BFloat16, Float16 };
+
+/*
+ * @brief How a layer constructor sets up the parameters
+ *
+ * Deferred skips the random initializer and allocates nothing, for layers
+ * whose parameters are loaded next (downloadParams, readParams): loading
+ * sizes them once, from the file. Until then, forward and backward throw
+ * std::logic_error.
+ */
+enum class ParameterInit { Random, Deferred };
+
+/*
+ * @brief Mutable view of one parameter tensor of a layer and its gradient
+ *
+ * values and grads share one layout (row padding included and kept at zero
+ * in both), so optimizers can update the parameter in place with a single
+ * linear sweep. values is null for weights stored in 16 bits (see
+ * WeightPrecision); those are read and written with getWeights/setWeights.
+ */
+template <typename T> struct ParameterView {
+  T *values;   // parameter buffer, or null if not stored as T
+  T *grads;    // gradient buffer
+  size_t size; // number of elements of both buffers
+};
+
+/*
+ * @brief How concurrent trainers write to shared parameters (Hogwild)
+ *
+ * Racy accumulates updates with plain loads and stores, so updates of two
+ * threads to the same value may overwrite each other; Hogwild SGD tolerates
+ * such rare collisions. Atomic adds every value with a relaxed atomic
+ * read-modify-write, so no update is lost, at the cost of a weight
+ * gradient buffer and a slower, element-wise update.
+ */
+enum class SharedUpdate { Racy, Atomic };
+
+/*
+ * @brief Bytes of memory held by a layer or a model, by purpose
+ */
+struct MemoryUsage {
+  size_t parameters;  // weights and biases
+  size_t gradients;   // weight and bias gradients
+  size_t activations; // forward results kept for backward, and scratch
+};
+
 /*
  * @brief Layer template implementing main operations of layer
+ * @tparam T scalar type of parameters and activations (float or double)
  */
-class Layer {
+template <typename T> class Layer {
 
 public:
   virtual ~Layer() = default;
@@ -18,7 +95,7 @@ public:
    * @param input output data (axon signals) from previous neurons
    * @return output data of this layer
    */
-  virtual vector<double> forward(const vector<double> &input) = 0;
+  virtual vector<T> forward(const vector<T> &input) = 0;
 
   /*
    * @brief Perform backward propagation (adjust weights)
@@ -26,53 +103,251 @@ public:
    * @param learning_rate learning rate
    * @return gradient
    */
-  virtual vector<double> backward(const vector<double> &output_grads) = 0;
+  virtual vector<T> backward(const vector<T> &output_grads) = 0;
 
   /*
-   * @brief Save weights to a file
+   * @brief Perform forward propagation for a batch of samples
+   * @param inputs batch of input data, one sample per row
+   * @return output data of this layer, one sample per row (owned by the
+   * layer and valid until its next forward)
+   */
+  virtual const Matrix<T> &forward(const Matrix<T> &inputs) = 0;
+
+  /*
+   * @brief Take the transient tensors of forward and backward (outputs,
+   * gradients) from an arena instead of buffers owned by the layer
+   * @param arena arena reset between steps, or nullptr for owned buffers
+   *
+   * With an arena, forward keeps a view of its input instead of a copy, so
+   * the input must stay alive until the matching backward.
+   */
+  virtual void setArena(Arena *arena) = 0;
+
+  /*
+   * @brief Switch between training and evaluation (inference only)
+   * @param training false to drop the gradients and the tensors kept for
+   * backward, true to allocate the gradients again
+   *
+   * In evaluation mode forward caches nothing and backward throws.
+   */
+  virtual void setTraining(bool training) = 0;
+
+  /*
+   * @brief Get the memory held by the layer (arena views not included)
+   */
+  virtual MemoryUsage memoryUsage() const = 0;
+
+  /*
+   * @brief Compute the output of one sample into a caller buffer
+   * @param input getInputSize() values
+   * @param output getOutputSize() values (must not alias input)
+   *
+   * Inference only: nothing is kept for backward and nothing is allocated.
+   */
+  virtual void forwardInto(const T *input, T *output) const = 0;
+
+  /*
+   * @brief Compute the outputs of a batch into a caller matrix
+   * @param inputs batch of input data, one sample per row
+   * @param outputs inputs.rows() x getOutputSize() matrix, overwritten
+   *
+   * Inference only and reentrant: threads may share one layer, each with
+   * its own outputs, as long as no one changes its parameters meanwhile.
+   */
+  virtual void forwardInto(const Matrix<T> &inputs,
+                           Matrix<T> &outputs) const = 0;
+
+  /*
+   * @brief Perform backward propagation for the last forwarded batch
+   * @param output_grads gradients from previous layers, one sample per row
+   * @return gradient with respect to the inputs, one sample per row (owned
+   * by the layer and valid until its next backward)
+   *
+   * Parameter gradients are summed over the rows of output_grads; the loss
+   * already scales its gradient by 1 / batch size, so the stored gradients
+   * are averages over the batch.
+   */
+  virtual const Matrix<T> &backward(const Matrix<T> &output_grads) = 0;
+
+  /*
+   * @brief Backward propagation that also applies W -= lr * dW and
+   * b -= lr * db in the same pass over the weights
+   * @param output_grads gradients from previous layers
+   * @param learning_rate step size of the update
+   * @return gradient with respect to the inputs (from the old weights)
+   *
+   * The weight gradients are never stored, so getWeightGrads() is empty
+   * afterwards. Needs weights in full precision.
+   */
+  virtual vector<T> backwardAndUpdate(const vector<T> &output_grads,
+                                      T learning_rate) = 0;
+
+  /*
+   * @brief Backward propagation fused with the update for a batch
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param learning_rate step size of the update
+   * @return gradient with respect to the inputs, one sample per row
+   */
+  virtual const Matrix<T> &backwardAndUpdate(const Matrix<T> &output_grads,
+                                             T learning_rate) = 0;
+
+  /*
+   * @brief Backward propagation of a batch forwarded with forwardInto, into
+   * caller gradient buffers
+   * @param inputs inputs of the batch
+   * @param outputs outputs forwardInto computed for inputs
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param input_grads inputs.rows() x getInputSize() matrix set to the
+   * gradient with respect to the inputs, or nullptr if not needed
+   * @param weight_grads set to the weight gradients; same shape and layout
+   * as getWeightGrads() (rows padded)
+   * @param bias_grads set to the bias gradients, single row matrix
+   * @param scratch arena for the temporaries of the call
+   *
+   * Const and reentrant: threads can compute gradients of different parts
+   * of a batch at once, to be combined before an optimizer step.
+   */
+  virtual void backwardInto(const Matrix<T> &inputs, const Matrix<T> &outputs,
+                            const Matrix<T> &output_grads,
+                            Matrix<T> *input_grads, Matrix<T> &weight_grads,
+                            Matrix<T> &bias_grads, Arena &scratch) const = 0;
+
+  /*
+   * @brief Backward propagation of a batch forwarded with forwardInto,
+   * applying W -= lr * dW and b -= lr * db straight to the parameters
+   * @param inputs inputs of the batch
+   * @param outputs outputs forwardInto computed for inputs
+   * @param output_grads gradients from previous layers, one sample per row
+   * @param input_grads inputs.rows() x getInputSize() matrix set to the
+   * gradient with respect to the inputs, or nullptr if not needed
+   * @param learning_rate step size of the update
+   * @param update how the update is written to the parameters
+   * @param scratch arena for the temporaries of the call
+   *
+   * Keeps no state in the layer, so threads can train one layer together
+   * (Hogwild), each with its own buffers. Needs full precision weights.
+   */
+  virtual void backwardAndUpdateInto(const Matrix<T> &inputs,
+                                     const Matrix<T> &outputs,
+                                     const Matrix<T> &output_grads,
+                                     Matrix<T> *input_grads, T learning_rate,
+                                     SharedUpdate update, Arena &scratch) = 0;
+
+  /*
+   * @brief Apply the layer's activation function to pre-activation values
+   * @param z weighted sums
+   * @param out output buffer (may alias z)
+   * @param n number of values
+   */
+  virtual void applyActivation(const T *z, T *out, size_t n) const = 0;
+
+  /*
+   * @brief Save weights to a file, tagged with the precision of T
    */
   virtual void saveParams() = 0;
 
   /*
    * @brief Initialize weights with downloaded parameters form a file
+   *
+   * Files saved in either precision are accepted and converted to T.
+   * Throws std::runtime_error if the file cannot be opened or parsed.
    */
   virtual void downloadParams() = 0;
 
+  /*
+   * @brief Add the parameters to a checkpoint being written
+   */
+  virtual void writeParams(checkpoint::Writer &writer) const = 0;
+
+  /*
+   * @brief Take the parameters from the next tensors of a checkpoint
+   *
+   * Tensors stored in the layer's own format are used in place, without a
+   * copy, and the layer keeps the checkpoint's memory alive; others are
+   * converted. Throws std::runtime_error, with the layer unchanged, if
+   * the tensors do not fit the layer's shape.
+   */
+  virtual void readParams(checkpoint::Reader &reader) = 0;
+
+  /*
+   * @brief Read the tensors readParams would take, without loading them,
+   * and throw std::runtime_error if readParams would reject them
+   */
+  virtual void checkParams(checkpoint::Reader &reader) const = 0;
+
+  /*
+   * @brief Name of the layer type in model archives and the Registry
+   */
+  virtual std::string typeName() const = 0;
+
   /*
    * @brief Get weight values in the layer
-   * @return weights
+   * @return weights (widened to T if stored in 16 bits)
    */
-  virtual vector<vector<double>> getWeights() const = 0;
+  virtual Matrix<T> getWeights() const = 0;
 
   /*
    * @brief Get bias values in the layer
-   * @return biases
+   * @return biases (single row matrix)
    */
-  virtual vector<double> getBiases() const = 0;
+  virtual Matrix<T> getBiases() const = 0;
 
   /*
    * @brief Get weight gradient values of the layer
    * @return weight gradients
    */
-  virtual vector<vector<double>> &getWeightGrads() = 0;
+  virtual Matrix<T> &getWeightGrads() = 0;
 
   /*
    * @brief Get bias gradient values of the layer
    * @return bias gradients
    */
-  virtual vector<double> &getBiasGrads() = 0;
+  virtual Matrix<T> &getBiasGrads() = 0;
+
+  /*
+   * @brief Get the number of parameter tensors of the layer
+   */
+  virtual size_t parameterCount() const = 0;
+
+  /*
+   * @brief Get a view of one parameter tensor and its gradient
+   * @param index tensor index below parameterCount()
+   * @return buffers owned by the layer, valid until it is resized
+   */
+  virtual ParameterView<T> parameter(size_t index) = 0;
 
   /*
    * @brief Set new values for weights
-   * @param new_weights new values of weights
+   * @param new_weights new values of weights (rounded if stored in 16 bits)
    */
-  virtual void setWeights(const vector<vector<double>> &new_weights) = 0;
+  virtual void setWeights(const Matrix<T> &new_weights) = 0;
 
   /*
    * @brief Set new values for biases
    * @param new_biases new values of biases
    */
-  virtual void setBiases(const vector<double> &new_biases) = 0;
+  virtual void setBiases(const Matrix<T> &new_biases) = 0;
+
+  /*
+   * @brief Change the storage format of the weights
+   * @param precision new format; converting to 16 bits rounds the weights
+   */
+  virtual void setWeightPrecision(WeightPrecision precision) = 0;
+
+  /*
+   * @brief Get the storage format of the weights
+   */
+  virtual WeightPrecision getWeightPrecision() const = 0;
+
+  /*
+   * @brief Version of the weights, changed by every write through the
+   * layer's methods (construction, setWeights, loading, a precision change)
+   * to a value from nextWeightVersion
+   *
+   * Writes through parameter() views keep it. Optimizers use it to tell
+   * whether a copy they keep of the weights is still current.
+   */
+  virtual uint64_t weightVersion() const = 0;
 
   /*
    * @brief Get the number of input connections
@@ -85,6 +360,21 @@ public:
    * @return number of output connections
    */
   virtual int getOutputSize() const = 0;
+
+  /*
+   * @brief Copy the parameters into a new layer of the same type, for the
+   * const forward and backward calls (e.g. one replica per NUMA node)
+   * @return layer in evaluation mode sharing nothing with this one; its
+   * buffers are first touched by the calling thread
+   */
+  virtual std::unique_ptr<Layer<T>> replicate() const = 0;
+
+  /*
+   * @brief Overwrite the parameters with those of the layer this one was
+   * replicated from, without allocating
+   * @param source layer of the same type, shape and weight precision
+   */
+  virtual void copyParameters(const Layer<T> &source) = 0;
 };
 
 #endif // !LAYER_H
@@ -0,0 +1,65 @@
+#ifndef QUANTIZEDLAYER_H
+#define QUANTIZEDLAYER_H
+
+#include "../Matrix.h"
+#include "Layer.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/*
+ * @brief Int8 inference copy of a trained layer
+ * @tparam T scalar type of the layer inputs and outputs (float or double)
+ *
+ * Weights are quantized symmetrically with one scale per output neuron
+ * (row of the weight matrix) and inputs with a single scale calibrated on
+ * sample data. The weighted sums are accumulated in int32 and dequantized
+ * once per output, right before the source layer's activation function.
+ */
+template <typename T> class QuantizedLayer {
+
+private:
+  Matrix<int8_t> weights;   // quantized weights, one unpadded row per neuron
+  vector<T> output_scales;  // input_scale * weight scale of each neuron
+  vector<T> biases;         // biases for each neuron
+  T input_scale;            // value of one input quantization step
+  const Layer<T> *source;   // layer providing the activation function
+
+public:
+  /*
+   * @brief Quantize the parameters of a layer
+   * @param layer trained layer; must outlive the quantized copy
+   * @param max_input largest absolute input value seen during calibration
+   */
+  QuantizedLayer(const Layer<T> &layer, T max_input);
+
+  /*
+   * @brief Perform forward propagation for a batch of samples
+   * @param inputs batch of input data, one sample per row
+   * @return output data of this layer, one sample per row
+   *
+   * Inputs beyond the calibrated range are clamped.
+   */
+  Matrix<T> forward(const Matrix<T> &inputs) const;
+
+  /*
+   * @brief Get the number of bytes held by the quantized parameters
+   */
+  size_t parameterBytes() const;
+
+  /*
+   * @brief Get the number of input connections
+   * @return number of input connections
+   */
+  int getInputSize() const;
+
+  /*
+   * @brief Get the number of output connections
+   * @return number of output connections
+   */
+  int getOutputSize() const;
+};
+
+#endif // !QUANTIZEDLAYER_H
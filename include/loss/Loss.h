@@ -1,11 +1,18 @@
 #ifndef LOSS_H
 #define LOSS_H
 
+#include "../Matrix.h"
+#include "../Memory.h"
+#include <string>
 #include <vector>
 
 using std::vector;
 
-class Loss {
+/*
+ * @brief Loss function template
+ * @tparam T scalar type of predictions and gradients (float or double)
+ */
+template <typename T> class Loss {
 
 public:
   virtual ~Loss() = default;
@@ -15,13 +22,65 @@ public:
    * @param prediction output value of model
    * @param target target value for output
    */
-  virtual double computeLoss(vector<double> &prediction,
-                             const vector<double> &target) = 0;
+  virtual T computeLoss(vector<T> &prediction, const vector<T> &target) = 0;
 
   /*
    * @brief Compute gradient in respect to loss function input values
    */
-  virtual vector<double> computeGrad() = 0;
+  virtual vector<T> computeGrad() = 0;
+
+  /*
+   * @brief Take the batch gradient from an arena instead of an owned buffer
+   * @param arena arena reset between steps, or nullptr for owned buffers
+   *
+   * With an arena, the batch loss keeps views of its arguments, so they
+   * must stay alive until computeBatchGrad.
+   */
+  virtual void setArena(Arena *arena) = 0;
+
+  /*
+   * @brief Check shapes and compute loss averaged over a batch
+   * @param predictions output values of model, one sample per row
+   * @param targets target values for output, one sample per row
+   */
+  virtual T computeLoss(const Matrix<T> &predictions,
+                        const Matrix<T> &targets) = 0;
+
+  /*
+   * @brief Compute the loss averaged over a batch without keeping anything
+   * for the gradient
+   * @param predictions output values of model, one sample per row
+   * @param targets target values for output, one sample per row
+   *
+   * Const and reentrant, for evaluation shared between threads.
+   */
+  virtual T evaluate(const Matrix<T> &predictions,
+                     const Matrix<T> &targets) const = 0;
+
+  /*
+   * @brief Compute the batch gradient into a caller matrix without keeping
+   * anything
+   * @param predictions output values of model, one sample per row
+   * @param targets target values for output, one sample per row
+   * @param gradient matrix of the shape of predictions, overwritten
+   *
+   * Const and reentrant, for trainers sharing the loss between threads.
+   */
+  virtual void gradientInto(const Matrix<T> &predictions,
+                            const Matrix<T> &targets,
+                            Matrix<T> &gradient) const = 0;
+
+  /*
+   * @brief Compute gradient for the last batch, averaged over its samples
+   * @return gradient, one sample per row (owned by the loss and valid until
+   * its next call)
+   */
+  virtual const Matrix<T> &computeBatchGrad() = 0;
+
+  /*
+   * @brief Name of the loss type in model archives and the Registry
+   */
+  virtual std::string typeName() const = 0;
 };
 
 #endif
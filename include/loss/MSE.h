@@ -1,6 +1,7 @@
 #ifndef MSE_H
 #define MSE_H
 
+#include "../Matrix.h"
 #include "Loss.h"
 #include <vector>
 
@@ -9,11 +10,15 @@ using std::vector;
 /*
  * @brief Implementation of Mean Squared Error loss function
  */
-class MSE : public Loss {
+template <typename T> class MSE : public Loss<T> {
 
 private:
-  vector<double> prediction;
-  vector<double> target;
+  vector<T> prediction;
+  vector<T> target;
+  Matrix<T> batch_prediction;
+  Matrix<T> batch_target;
+  Matrix<T> batch_gradient;
+  Arena *arena = nullptr;
 
 public:
   /*
@@ -21,13 +26,50 @@ public:
    * @param prediction - output value of model
    * @param target - target value for output
    */
-  double computeLoss(vector<double> &prediction,
-                     const vector<double> &target) override;
+  T computeLoss(vector<T> &prediction, const vector<T> &target) override;
 
   /*
    * @brief Compute gradient in respect to loss function input values
    */
-  vector<double> computeGrad() override;
+  vector<T> computeGrad() override;
+
+  /*
+   * @brief Take the batch gradient from an arena (nullptr: owned buffer)
+   */
+  void setArena(Arena *arena) override;
+
+  /*
+   * @brief Check shapes and compute loss averaged over a batch
+   * @param predictions output values of model, one sample per row
+   * @param targets target values for output, one sample per row
+   */
+  T computeLoss(const Matrix<T> &predictions,
+                const Matrix<T> &targets) override;
+
+  /*
+   * @brief Compute the loss averaged over a batch without keeping anything
+   * for the gradient
+   */
+  T evaluate(const Matrix<T> &predictions,
+             const Matrix<T> &targets) const override;
+
+  /*
+   * @brief Compute the batch gradient into a caller matrix without keeping
+   * anything
+   */
+  void gradientInto(const Matrix<T> &predictions, const Matrix<T> &targets,
+                    Matrix<T> &gradient) const override;
+
+  /*
+   * @brief Compute gradient for the last batch, averaged over its samples
+   * @return gradient, one sample per row
+   */
+  const Matrix<T> &computeBatchGrad() override;
+
+  /*
+   * @brief "MSE"
+   */
+  std::string typeName() const override;
 };
 
 #endif // !MSE_H
@@ -2,20 +2,63 @@
 #define OPTIMIZER_H
 
 #include "../layers/Layer.h"
+#include <istream>
 #include <memory>
+#include <ostream>
+#include <string>
 
 /*
  * @brief Implementation of a template for optimization functions
+ * @tparam T scalar type of the optimized layers (float or double)
  */
-class Optimizer {
+template <typename T> class Optimizer {
 public:
-  ~Optimizer() = default;
+  virtual ~Optimizer() = default;
 
   /*
    * @brief Correct weights
    * @param layer pointer to a layer object
    */
-  virtual void step(Layer &layer) = 0;
+  virtual void step(Layer<T> &layer) = 0;
+
+  /*
+   * @brief Drop the state kept for a layer whose weights were replaced or
+   * changed format outside the optimizer
+   */
+  virtual void resetState(const Layer<T> & /*layer*/) {}
+
+  /*
+   * @brief Learning rate of an update that layers can apply during backward
+   * @param learning_rate set to the step size if the update is plain
+   * W -= learning_rate * dW for every parameter
+   * @return whether the optimizer can be fused (false: it needs gradients)
+   */
+  virtual bool fusedLearningRate(T & /*learning_rate*/) const { return false; }
+
+  /*
+   * @brief Name of the optimizer type in model archives and the Registry
+   */
+  virtual std::string typeName() const = 0;
+
+  /*
+   * @brief Save the hyperparameters and the state kept between steps
+   * @param layers layers of the model; state kept per layer is saved by
+   * index in this order
+   * @param config receives the hyperparameters, on one line
+   * @param writer receives the state tensors
+   */
+  virtual void saveState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                         std::ostream &config,
+                         checkpoint::Writer &writer) const = 0;
+
+  /*
+   * @brief Restore what saveState saved, into an optimizer created by the
+   * Registry
+   * @param layers layers of the loaded model, in the saved order
+   */
+  virtual void loadState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                         std::istream &config,
+                         checkpoint::Reader &reader) = 0;
 };
 
 #endif // !OPTIMIZER_H
@@ -3,20 +3,71 @@
 
 #include "../layers/Layer.h"
 #include "Optimizer.h"
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 
-class SGD : public Optimizer {
+template <typename T> class SGD : public Optimizer<T> {
 private:
-  float learning_rate;
+  T learning_rate;
+
+  /*
+   * @brief Full-precision copy of weights that a layer keeps in 16 bits, so
+   * small updates are not rounded away between steps
+   */
+  struct MasterCopy {
+    Matrix<T> weights;
+    uint64_t version = 0; // layer's weightVersion() matching weights
+  };
+
+  // Keyed by layer; a copy is only used while its version is the layer's,
+  // so weights written outside step and new layers at a reused address
+  // start from their own weights
+  std::unordered_map<const Layer<T> *, MasterCopy> master_weights;
+
+  /*
+   * @brief Master copy of a layer's weights if it is current, else null
+   */
+  const MasterCopy *currentMaster(const Layer<T> &layer) const;
 
 public:
-  SGD(float lr);
+  SGD(T lr);
 
   /*
    * @brief Correct weights
    * @param layer pointer to a layer object
    */
-  void step(Layer &layer) override;
+  void step(Layer<T> &layer) override;
+
+  /*
+   * @brief Drop the master copy of a layer's weights
+   */
+  void resetState(const Layer<T> &layer) override;
+
+  /*
+   * @brief SGD is a plain update and can always be fused
+   * @param learning_rate set to the optimizer's learning rate
+   */
+  bool fusedLearningRate(T &learning_rate) const override;
+
+  /*
+   * @brief "SGD"
+   */
+  std::string typeName() const override;
+
+  /*
+   * @brief Save the learning rate and the master copies of 16-bit weights
+   */
+  void saveState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                 std::ostream &config,
+                 checkpoint::Writer &writer) const override;
+
+  /*
+   * @brief Restore the learning rate and the master copies of 16-bit
+   * weights
+   */
+  void loadState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                 std::istream &config, checkpoint::Reader &reader) override;
 };
 
 #endif // !SGD_H
@@ -1,9 +1,19 @@
 #include "../include/Activation.h"
+#include "../include/kernels/ActivationKernels.h"
+#include <atomic>
 #include <cmath>
 
 // Helper activation functions
 namespace activation {
 
+namespace {
+std::atomic<Mode> current_mode(Mode::Exact);
+} // namespace
+
+void setMode(Mode mode) { current_mode.store(mode, std::memory_order_relaxed); }
+
+Mode getMode() { return current_mode.load(std::memory_order_relaxed); }
+
 double sigmoid(double x) { return 1.0 / (1.0 + std::exp(-x)); }
 
 double sigmoid_derivative(double x) { return x * (1.0 - x); }
@@ -11,4 +21,63 @@ double sigmoid_derivative(double x) { return x * (1.0 - x); }
 double tanh(double x) { return std::tanh(x); }
 
 double tanh_derivative(double x) { return 1.0 - x * x; }
+
+template <typename T> void relu(const T *z, T *out, size_t n) {
+  kernels::activationKernels<T>().relu(z, out, n);
+}
+
+template <typename T>
+void relu_derivative(const T *z, const T *grad, T *out, size_t n) {
+  kernels::activationKernels<T>().relu_derivative(z, grad, out, n);
+}
+
+template <typename T> void leaky_relu(const T *z, T *out, size_t n) {
+  kernels::activationKernels<T>().leaky_relu(z, out, n);
+}
+
+template <typename T>
+void leaky_relu_derivative(const T *z, const T *grad, T *out, size_t n) {
+  kernels::activationKernels<T>().leaky_relu_derivative(z, grad, out, n);
+}
+
+template <typename T> void sigmoid(const T *z, T *out, size_t n) {
+  const kernels::ActivationKernels<T> &k = kernels::activationKernels<T>();
+  if (getMode() == Mode::Fast)
+    k.fast_sigmoid(z, out, n);
+  else
+    k.sigmoid(z, out, n);
+}
+
+template <typename T>
+void sigmoid_derivative(const T *y, const T *grad, T *out, size_t n) {
+  kernels::activationKernels<T>().sigmoid_derivative(y, grad, out, n);
+}
+
+template <typename T> void tanh(const T *z, T *out, size_t n) {
+  const kernels::ActivationKernels<T> &k = kernels::activationKernels<T>();
+  if (getMode() == Mode::Fast)
+    k.fast_tanh(z, out, n);
+  else
+    k.tanh(z, out, n);
+}
+
+template <typename T>
+void tanh_derivative(const T *y, const T *grad, T *out, size_t n) {
+  kernels::activationKernels<T>().tanh_derivative(y, grad, out, n);
+}
+
+#define EASYLEARN_INSTANTIATE(T)                                               \
+  template void relu<T>(const T *, T *, size_t);                               \
+  template void relu_derivative<T>(const T *, const T *, T *, size_t);         \
+  template void leaky_relu<T>(const T *, T *, size_t);                         \
+  template void leaky_relu_derivative<T>(const T *, const T *, T *, size_t);   \
+  template void sigmoid<T>(const T *, T *, size_t);                            \
+  template void sigmoid_derivative<T>(const T *, const T *, T *, size_t);      \
+  template void tanh<T>(const T *, T *, size_t);                               \
+  template void tanh_derivative<T>(const T *, const T *, T *, size_t);
+
+EASYLEARN_INSTANTIATE(float)
+EASYLEARN_INSTANTIATE(double)
+
+#undef EASYLEARN_INSTANTIATE
 } // namespace activation
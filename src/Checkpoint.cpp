@@ -0,0 +1,404 @@
+#include "../include/Checkpoint.h"
+#include "../include/Memory.h"
+#include "../include/kernels/Half.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHECKPOINT_POSIX
+#endif
+
+namespace checkpoint {
+
+namespace {
+
+const char magic[8] = {'E', 'Z', 'L', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t byte_order = 0x01020304; // reads differently on other ends
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t tensor_count;
+  uint64_t metadata_bytes;
+  uint64_t payload_alignment;
+  uint64_t file_bytes; // catches truncated files
+  uint64_t checksum;   // of header (this field 0), table and metadata
+  uint64_t reserved;
+};
+
+struct TensorRecord {
+  uint32_t dtype;
+  uint32_t reserved;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t stride;   // in elements
+  uint64_t offset;   // of the payload from the start of the file
+  uint64_t bytes;    // rows * stride * element size
+  uint64_t checksum; // of the payload
+  uint64_t reserved2;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+static_assert(sizeof(TensorRecord) == 64, "TensorRecord must be 64 bytes");
+
+size_t alignUp(size_t value) {
+  return (value + payload_alignment - 1) / payload_alignment *
+         payload_alignment;
+}
+
+/*
+ * @brief FNV-1a over 64-bit words, then the trailing bytes
+ * @param hash checksum of the bytes before these, to continue it
+ */
+uint64_t checksum(const void *data, size_t bytes,
+                  uint64_t hash = 14695981039346656037ull) {
+  const uint64_t prime = 1099511628211ull;
+  const unsigned char *bytes_in = static_cast<const unsigned char *>(data);
+
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes_in + i, 8);
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < bytes; i++) {
+    hash = (hash ^ bytes_in[i]) * prime;
+  }
+  return hash;
+}
+
+/*
+ * @brief Header checksum: the header with its checksum field at 0, then
+ * the table and the metadata, as laid out in the file
+ */
+uint64_t headerChecksum(const FileHeader &header, const void *rest,
+                        size_t rest_bytes) {
+  FileHeader zeroed = header;
+  zeroed.checksum = 0;
+  return checksum(rest, rest_bytes, checksum(&zeroed, sizeof(zeroed)));
+}
+
+bool isDType(uint32_t value) {
+  return value >= static_cast<uint32_t>(DType::Float32) &&
+         value <= static_cast<uint32_t>(DType::Float16);
+}
+
+/*
+ * @brief Read a whole file into a buffer aligned like Matrix storage
+ */
+std::shared_ptr<void> readFile(const std::string &path, size_t &bytes) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    throw std::runtime_error("Cannot open checkpoint " + path);
+  }
+
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  bytes = size > 0 ? static_cast<size_t>(size) : 0;
+
+  std::shared_ptr<void> buffer(memory::allocate(bytes, payload_alignment),
+                               std::free);
+  size_t read = bytes > 0 ? std::fread(buffer.get(), 1, bytes, file) : 0;
+  std::fclose(file);
+  if (read != bytes) {
+    throw std::runtime_error("Cannot read checkpoint " + path);
+  }
+  return buffer;
+}
+
+#ifdef CHECKPOINT_POSIX
+/*
+ * @brief Map a whole file privately: pages are shared with the page cache
+ * until written, and writes never reach the file
+ * @return null if the file cannot be mapped
+ */
+std::shared_ptr<void> mapFile(const std::string &path, size_t &bytes) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open checkpoint " + path);
+  }
+
+  struct stat info;
+  void *address = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    bytes = static_cast<size_t>(info.st_size);
+    address =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+
+  if (address == MAP_FAILED)
+    return nullptr;
+  size_t length = bytes;
+  return std::shared_ptr<void>(address,
+                               [length](void *p) { munmap(p, length); });
+}
+#endif
+
+} // namespace
+
+size_t elementSize(DType dtype) {
+  switch (dtype) {
+  case DType::Float32:
+    return 4;
+  case DType::Float64:
+    return 8;
+  case DType::BFloat16:
+  case DType::Float16:
+    return 2;
+  }
+  throw std::invalid_argument("Unknown checkpoint dtype");
+}
+
+void Writer::add(const Matrix<float> &matrix) {
+  entries.push_back({DType::Float32, matrix.rows(), matrix.cols(),
+                     matrix.stride(), matrix.data()});
+}
+
+void Writer::add(const Matrix<double> &matrix) {
+  entries.push_back({DType::Float64, matrix.rows(), matrix.cols(),
+                     matrix.stride(), matrix.data()});
+}
+
+void Writer::add(const Matrix<uint16_t> &matrix, DType dtype) {
+  if (elementSize(dtype) != sizeof(uint16_t)) {
+    throw std::invalid_argument("16-bit matrix needs a 16-bit dtype");
+  }
+  entries.push_back(
+      {dtype, matrix.rows(), matrix.cols(), matrix.stride(), matrix.data()});
+}
+
+/*
+ * @brief Write the header, the matrices and metadata to a file
+ */
+void Writer::write(const std::string &path,
+                   const std::string &metadata) const {
+  // Layout: header, table and metadata, then aligned payloads
+  std::vector<unsigned char> head(sizeof(FileHeader) +
+                                  entries.size() * sizeof(TensorRecord) +
+                                  metadata.size());
+  size_t offset = alignUp(head.size());
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    const Entry &entry = entries[i];
+    TensorRecord record = {};
+    record.dtype = static_cast<uint32_t>(entry.dtype);
+    record.rows = entry.rows;
+    record.cols = entry.cols;
+    record.stride = entry.stride;
+    record.offset = offset;
+    record.bytes = entry.rows * entry.stride * elementSize(entry.dtype);
+    record.checksum = checksum(entry.data, record.bytes);
+    std::memcpy(head.data() + sizeof(FileHeader) + i * sizeof(TensorRecord),
+                &record, sizeof(record));
+    offset = alignUp(offset + record.bytes);
+  }
+  if (!metadata.empty()) {
+    std::memcpy(head.data() + head.size() - metadata.size(), metadata.data(),
+                metadata.size());
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byte_order = byte_order;
+  header.tensor_count = entries.size();
+  header.metadata_bytes = metadata.size();
+  header.payload_alignment = payload_alignment;
+  header.file_bytes = offset;
+  header.checksum = headerChecksum(header, head.data() + sizeof(FileHeader),
+                                   head.size() - sizeof(FileHeader));
+  std::memcpy(head.data(), &header, sizeof(header));
+
+  // Written aside and renamed, so the old file stays whole until then
+  std::string temporary = path + ".tmp";
+  std::FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (file == nullptr) {
+    throw std::runtime_error("Cannot write checkpoint " + path);
+  }
+
+  const unsigned char zeros[payload_alignment] = {};
+  bool ok = std::fwrite(head.data(), 1, head.size(), file) == head.size();
+  size_t written = head.size();
+  for (size_t i = 0; ok && i < entries.size(); i++) {
+    const Entry &entry = entries[i];
+    size_t bytes = entry.rows * entry.stride * elementSize(entry.dtype);
+    size_t gap = alignUp(written) - written;
+
+    ok = std::fwrite(zeros, 1, gap, file) == gap &&
+         std::fwrite(entry.data, 1, bytes, file) == bytes;
+    written += gap + bytes;
+  }
+  size_t gap = alignUp(written) - written;
+  ok = ok && std::fwrite(zeros, 1, gap, file) == gap;
+
+  ok = std::fflush(file) == 0 && ok;
+#ifdef CHECKPOINT_POSIX
+  ok = ok && fsync(fileno(file)) == 0;
+#endif
+  ok = std::fclose(file) == 0 && ok;
+
+  if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("Cannot write checkpoint " + path);
+  }
+}
+
+/*
+ * @brief Open a checkpoint and check its header
+ */
+Reader::Reader(const std::string &path, bool map, bool verify)
+    : next(0), is_mapped(false) {
+  size_t bytes = 0;
+#ifdef CHECKPOINT_POSIX
+  if (map) {
+    buffer = mapFile(path, bytes);
+    is_mapped = buffer != nullptr;
+  }
+#else
+  (void)map;
+#endif
+  if (!buffer) {
+    buffer = readFile(path, bytes);
+  }
+  unsigned char *base = static_cast<unsigned char *>(buffer.get());
+
+  FileHeader header;
+  if (bytes < sizeof(header) ||
+      std::memcmp(base, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a checkpoint: " + path);
+  }
+  std::memcpy(&header, base, sizeof(header));
+
+  if (header.byte_order != byte_order) {
+    throw std::runtime_error("Checkpoint has another byte order: " + path);
+  }
+  if (header.version > version) {
+    throw std::runtime_error("Checkpoint version " +
+                             std::to_string(header.version) +
+                             " is newer than this build reads: " + path);
+  }
+  if (header.payload_alignment == 0 ||
+      header.payload_alignment % Matrix<double>::alignment != 0) {
+    throw std::runtime_error("Unsupported checkpoint alignment: " + path);
+  }
+
+  // Sizes are checked before they are trusted for the checksum
+  size_t head_bytes = sizeof(FileHeader);
+  if (header.tensor_count > (bytes - head_bytes) / sizeof(TensorRecord) ||
+      header.metadata_bytes >
+          bytes - head_bytes - header.tensor_count * sizeof(TensorRecord) ||
+      header.file_bytes != bytes) {
+    throw std::runtime_error("Truncated checkpoint: " + path);
+  }
+  size_t rest_bytes =
+      header.tensor_count * sizeof(TensorRecord) + header.metadata_bytes;
+  if (headerChecksum(header, base + head_bytes, rest_bytes) !=
+      header.checksum) {
+    throw std::runtime_error("Corrupt checkpoint header: " + path);
+  }
+
+  meta.assign(reinterpret_cast<const char *>(base + head_bytes +
+                                             rest_bytes -
+                                             header.metadata_bytes),
+              header.metadata_bytes);
+
+  for (size_t i = 0; i < header.tensor_count; i++) {
+    TensorRecord record;
+    std::memcpy(&record, base + head_bytes + i * sizeof(TensorRecord),
+                sizeof(record));
+
+    if (!isDType(record.dtype) || record.stride < record.cols) {
+      throw std::runtime_error("Corrupt checkpoint tensor " +
+                               std::to_string(i) + ": " + path);
+    }
+    DType dtype = static_cast<DType>(record.dtype);
+    if (record.offset % header.payload_alignment != 0 ||
+        record.bytes != record.rows * record.stride * elementSize(dtype) ||
+        record.offset > bytes || record.bytes > bytes - record.offset) {
+      throw std::runtime_error("Corrupt checkpoint tensor " +
+                               std::to_string(i) + ": " + path);
+    }
+    if (verify && checksum(base + record.offset, record.bytes) !=
+                      record.checksum) {
+      throw std::runtime_error("Checksum mismatch in checkpoint tensor " +
+                               std::to_string(i) + ": " + path);
+    }
+
+    tensors.push_back(
+        {dtype, record.rows, record.cols, record.stride, base + record.offset});
+  }
+}
+
+const Tensor &Reader::read() {
+  if (next == tensors.size()) {
+    throw std::runtime_error("Checkpoint has fewer tensors than the model");
+  }
+  return tensors[next++];
+}
+
+/*
+ * @brief Point a matrix at a tensor without copying it
+ */
+template <typename T>
+bool view(const Tensor &tensor, DType dtype, Matrix<T> &matrix) {
+  if (tensor.dtype != dtype || elementSize(dtype) != sizeof(T))
+    return false;
+
+  matrix = Matrix<T>::view(static_cast<T *>(tensor.data), tensor.rows,
+                           tensor.cols, tensor.stride);
+  return true;
+}
+
+/*
+ * @brief Copy a tensor into a matrix of its shape, converting its values
+ */
+template <typename T>
+void copy(const Tensor &tensor, Matrix<T> &matrix, bool padded) {
+  // The stride of the file may not be the padding of T (other dtypes).
+  // The old buffer may be larger or a view of another checkpoint, so a new
+  // one of exactly this shape is taken; it is zeroed, so only the values
+  // are written.
+  matrix = Matrix<T>();
+  matrix.reshape(tensor.rows, tensor.cols, padded);
+
+  for (size_t i = 0; i < tensor.rows; i++) {
+    const char *row = static_cast<const char *>(tensor.data) +
+                      i * tensor.stride * elementSize(tensor.dtype);
+    T *out = matrix.row(i);
+
+    switch (tensor.dtype) {
+    case DType::Float32:
+      std::copy_n(reinterpret_cast<const float *>(row), tensor.cols, out);
+      break;
+    case DType::Float64:
+      std::copy_n(reinterpret_cast<const double *>(row), tensor.cols, out);
+      break;
+    case DType::BFloat16:
+      kernels::widenHalf(reinterpret_cast<const uint16_t *>(row), out,
+                         tensor.cols, kernels::HalfFormat::BFloat16);
+      break;
+    case DType::Float16:
+      kernels::widenHalf(reinterpret_cast<const uint16_t *>(row), out,
+                         tensor.cols, kernels::HalfFormat::Float16);
+      break;
+    }
+  }
+}
+
+template bool view(const Tensor &, DType, Matrix<float> &);
+template bool view(const Tensor &, DType, Matrix<double> &);
+template bool view(const Tensor &, DType, Matrix<uint16_t> &);
+template void copy(const Tensor &, Matrix<float> &, bool);
+template void copy(const Tensor &, Matrix<double> &, bool);
+
+} // namespace checkpoint
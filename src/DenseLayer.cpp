@@ -0,0 +1,1080 @@
+#include "../include/layers/DenseLayer.h"
+#include "../include/layers/HalfWeights.h"
+#include "../include/Scheduler.h"
+#include "../include/kernels/Gemm.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace {
+// Output block of the fused forward epilogue: about half of a typical L2,
+// and enough rows that repacking the weights for each block stays cheap
+constexpr size_t epilogue_bytes = 1024 * 1024;
+constexpr size_t epilogue_min_rows = 64;
+
+/*
+ * @brief Parse a layer size line of a parameter file
+ * @param path file, for the error message
+ */
+int parseSize(const std::string &line, const std::string &path) {
+  int size = 0;
+  try {
+    size = std::stoi(line);
+  } catch (const std::logic_error &) {
+    // invalid_argument or out_of_range, reported as a bad file below
+  }
+  if (size <= 0) {
+    throw std::runtime_error("Invalid layer size in parameter file " + path);
+  }
+  return size;
+}
+} // namespace
+
+template <typename T, typename Activation>
+DenseLayer<T, Activation>::DenseLayer(int input, int neurons,
+                                      std::string file_name,
+                                      ParameterInit init) {
+  input_size = input;
+  output_size = neurons;
+  config_name = file_name;
+  weight_precision = WeightPrecision::Full;
+  weight_version = nextWeightVersion();
+  arena = nullptr;
+  training = true;
+
+  // Buffers are sized by the load, gradients included
+  if (init == ParameterInit::Deferred)
+    return;
+
+  // He or Xavier/Glorot initialization, depending on the activation
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  double stddev = Activation::stddev(input_size, output_size);
+  std::normal_distribution<T> dist(0.0, stddev);
+
+  weights.resize(output_size, input_size, 0.0, true);
+  biases.resize(1, output_size, 0.1);
+  allocateGrads();
+
+  for (int i = 0; i < output_size; i++) {
+    T *row = weights.row(i);
+    for (int j = 0; j < input_size; j++) {
+      row[j] = dist(gen);
+    }
+  }
+}
+
+/*
+ * @brief Empty layer in evaluation mode, filled by replicate
+ */
+template <typename T, typename Activation>
+DenseLayer<T, Activation>::DenseLayer()
+    : weight_precision(WeightPrecision::Full),
+      weight_version(nextWeightVersion()), input_size(0), output_size(0),
+      arena(nullptr), training(false) {}
+
+/*
+ * @brief Perform forward propagation
+ * @param input output data (axon signals) from previous neurons
+ * @return output data of this layer
+ */
+template <typename T, typename Activation>
+vector<T> DenseLayer<T, Activation>::forward(const vector<T> &input) {
+  if (!training) {
+    vector<T> output(output_size);
+    forwardInto(input.data(), output.data());
+    return output;
+  }
+
+  // with an arena, last_input is a view of this batch
+  Matrix<T> batch;
+  scratch(batch, 1, input.size());
+  std::copy(input.begin(), input.end(), batch.row(0));
+
+  const Matrix<T> &output = forward(batch);
+  return vector<T>(output.row(0), output.row(0) + output.cols());
+}
+
+/*
+ * @brief Perform backward propagation (adjust weights)
+ * @param output_grads gradients from previous layers
+ * @return gradient
+ */
+template <typename T, typename Activation>
+vector<T>
+DenseLayer<T, Activation>::backward(const vector<T> &output_gradient) {
+  Matrix<T> batch;
+  scratch(batch, 1, output_gradient.size());
+  std::copy(output_gradient.begin(), output_gradient.end(), batch.row(0));
+
+  const Matrix<T> &input_gradient = backward(batch);
+  return vector<T>(input_gradient.row(0),
+                   input_gradient.row(0) + input_gradient.cols());
+}
+
+/*
+ * @brief Accumulate x * W^T onto z for a block of rows and a range of
+ * neurons
+ * @param rows number of rows of x and z
+ * @param first first neuron (column of z) to compute
+ * @param last one past the last neuron to compute
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::multiplyWeights(size_t rows, size_t first,
+                                                size_t last, const T *x,
+                                                size_t ldx, T *z,
+                                                size_t ldz) const {
+  if (weight_precision == WeightPrecision::Full) {
+    kernels::gemm(kernels::Transpose::No, kernels::Transpose::Yes, rows,
+                  last - first, input_size, T(1), x, ldx, weights.row(first),
+                  weights.stride(), T(1), z + first, ldz);
+  } else {
+    kernels::gemm(kernels::Transpose::No, kernels::Transpose::Yes, rows,
+                  last - first, input_size, T(1), x, ldx,
+                  half_weights.row(first), halfFormat(weight_precision),
+                  half_weights.stride(), T(1), z + first, ldz);
+  }
+}
+
+/*
+ * @brief Compute y = f(x * W^T + b) for a block of rows and a range of
+ * neurons
+ * @param rows number of rows of x and y
+ * @param first first neuron (column of y) to compute
+ * @param last one past the last neuron to compute
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::forwardBlock(size_t rows, size_t first,
+                                             size_t last, const T *x,
+                                             size_t ldx, T *y,
+                                             size_t ldy) const {
+  size_t width = last - first;
+
+  for (size_t n = 0; n < rows; n++) {
+    std::copy(biases.row(0) + first, biases.row(0) + last,
+              y + n * ldy + first);
+  }
+  multiplyWeights(rows, first, last, x, ldx, y, ldy);
+
+  // whole unpadded rows are contiguous
+  if (width == ldy || rows == 1) {
+    Activation::apply(y + first, y + first, rows * width);
+  } else {
+    for (size_t n = 0; n < rows; n++) {
+      Activation::apply(y + n * ldy + first, y + n * ldy + first, width);
+    }
+  }
+}
+
+/*
+ * @brief Perform forward propagation for a batch of samples
+ * @param inputs batch of input data, one sample per row
+ * @return output data of this layer, one sample per row
+ */
+template <typename T, typename Activation>
+const Matrix<T> &DenseLayer<T, Activation>::forward(const Matrix<T> &inputs) {
+  size_t batch_size = inputs.rows();
+
+  if (!training) {
+    // nothing is kept for backward
+  } else if (arena != nullptr) {
+    // only read, and alive until backward (see Layer::setArena)
+    last_input = Matrix<T>::view(const_cast<T *>(inputs.data()), batch_size,
+                                 inputs.cols(), inputs.stride());
+  } else {
+    last_input = inputs;
+  }
+  scratch(last_output, batch_size, output_size);
+
+  forwardInto(inputs, last_output);
+
+  return last_output;
+}
+
+/*
+ * @brief Shape a transient buffer, taken from the arena if there is one
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::scratch(Matrix<T> &buffer, size_t rows,
+                                        size_t cols) {
+  if (arena != nullptr) {
+    buffer = Matrix<T>::view(arena->allocate<T>(rows * cols), rows, cols, cols);
+  } else {
+    buffer.reshape(rows, cols);
+  }
+}
+
+/*
+ * @brief Take outputs and gradients from an arena (nullptr: owned buffers)
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::setArena(Arena *new_arena) {
+  arena = new_arena;
+
+  // buffers are owned again, or come from the arena on the next step
+  last_input = Matrix<T>();
+  last_output = Matrix<T>();
+  delta = Matrix<T>();
+  input_grads = Matrix<T>();
+}
+
+/*
+ * @brief Allocate the weight and bias gradients
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::allocateGrads() {
+  // New buffers of exactly the layer's shape, zeroed by the allocator: the
+  // old ones may be larger, from before a load changed the shape
+  weight_grads = Matrix<T>();
+  weight_grads.reshape(output_size, input_size, true);
+  bias_grads = Matrix<T>();
+  bias_grads.reshape(1, output_size);
+}
+
+/*
+ * @brief Throw if the parameters were deferred and have not been loaded
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::requireParameters() const {
+  if (biases.empty()) {
+    throw std::logic_error(std::string("Parameters not loaded in ") +
+                           Activation::name + "Layer");
+  }
+}
+
+/*
+ * @brief Switch between training and evaluation (inference only)
+ * @param mode false to drop gradients and cached tensors
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::setTraining(bool mode) {
+  if (mode == training)
+    return;
+  training = mode;
+
+  if (training) {
+    allocateGrads();
+  } else {
+    weight_grads = Matrix<T>();
+    bias_grads = Matrix<T>();
+    last_input = Matrix<T>();
+    last_output = Matrix<T>();
+    delta = Matrix<T>();
+    input_grads = Matrix<T>();
+  }
+}
+
+/*
+ * @brief Get the memory held by the layer (arena views not included)
+ */
+template <typename T, typename Activation>
+MemoryUsage DenseLayer<T, Activation>::memoryUsage() const {
+  MemoryUsage usage;
+  usage.parameters = weights.allocatedBytes() +
+                     half_weights.allocatedBytes() + biases.allocatedBytes();
+  usage.gradients = weight_grads.allocatedBytes() + bias_grads.allocatedBytes();
+  usage.activations = last_input.allocatedBytes() +
+                      last_output.allocatedBytes() + delta.allocatedBytes() +
+                      input_grads.allocatedBytes();
+  return usage;
+}
+
+/*
+ * @brief Compute the output of one sample into a caller buffer
+ * @param input getInputSize() values
+ * @param output getOutputSize() values
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::forwardInto(const T *input, T *output) const {
+  requireParameters();
+
+  // one sample: the neurons are the only work to split
+  parallel::forRange(output_size, size_t(input_size) * output_size,
+                     [&](size_t first, size_t last) {
+                       forwardBlock(1, first, last, input, input_size, output,
+                                    output_size);
+                     });
+}
+
+/*
+ * @brief Compute the outputs of a batch into a caller matrix
+ * @param inputs batch of input data, one sample per row
+ * @param outputs inputs.rows() x getOutputSize() matrix, overwritten
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::forwardInto(const Matrix<T> &inputs,
+                                            Matrix<T> &outputs) const {
+  requireParameters();
+  size_t batch_size = inputs.rows();
+  size_t ldo = outputs.stride();
+
+  if (outputs.rows() != batch_size ||
+      outputs.cols() != static_cast<size_t>(output_size)) {
+    throw std::invalid_argument(std::string("Output shape mismatch in ") +
+                                Activation::name + "Layer");
+  }
+
+  // Y = f(X * W^T + b), in blocks of rows whose outputs fit in L2 so the
+  // activation reads values the product has just written
+  size_t block = std::max<size_t>(
+      epilogue_min_rows,
+      epilogue_bytes / (std::max(output_size, 1) * sizeof(T)));
+
+  // each thread owns a range of neurons, so its slice of W stays in its
+  // cache across the row blocks
+  parallel::forRange(
+      output_size, batch_size * input_size * output_size,
+      [&](size_t first, size_t last) {
+        for (size_t r = 0; r < batch_size; r += block) {
+          size_t rows = std::min(block, batch_size - r);
+          forwardBlock(rows, first, last, inputs.row(r), inputs.stride(),
+                       outputs.row(r), ldo);
+        }
+      });
+}
+
+/*
+ * @brief Compute the gradient with respect to the weighted sums (z) and sum
+ * it over the batch into bias_grads
+ * @param output_gradient gradients from previous layers
+ * @return z gradients: delta, or output_gradient for the identity
+ */
+template <typename T, typename Activation>
+const Matrix<T> &
+DenseLayer<T, Activation>::zGradient(const Matrix<T> &output_gradient) {
+  if (!training) {
+    throw std::logic_error(std::string("Backward in evaluation mode in ") +
+                           Activation::name + "Layer");
+  }
+  requireParameters();
+  size_t batch_size = last_input.rows();
+
+  // For the identity the z gradients are the output gradients
+  if (!Activation::linear) {
+    scratch(delta, batch_size, output_size);
+  }
+  const Matrix<T> &dz = Activation::linear ? output_gradient : delta;
+
+  bias_grads.fill(0.0);
+
+  // Compute gradient with respect to the weighted sum (z) from the outputs
+  // bias gradients are sums of z gradients over the batch
+  for (size_t n = 0; n < batch_size; n++) {
+    if (!Activation::linear) {
+      Activation::derivative(last_output.row(n), output_gradient.row(n),
+                             delta.row(n), output_size);
+    }
+
+    const T *d = dz.row(n);
+    for (int i = 0; i < output_size; i++) {
+      bias_grads(0, i) += d[i];
+    }
+  }
+  return dz;
+}
+
+/*
+ * @brief Gradient with respect to the inputs, input_grads = delta * W
+ * @param dz gradients with respect to the weighted sums
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::inputGradient(const Matrix<T> &dz) {
+  scratch(input_grads, dz.rows(), input_size);
+  inputGradientInto(dz, input_grads);
+}
+
+/*
+ * @brief Gradient with respect to the inputs into a caller matrix, dx = dz * W
+ * @param dz gradients with respect to the weighted sums
+ * @param dx dz.rows() x input_size matrix, overwritten
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::inputGradientInto(const Matrix<T> &dz,
+                                                  Matrix<T> &dx) const {
+  size_t batch_size = dz.rows();
+
+  // split over the input columns, each a sum over all the neurons
+  parallel::forRange(
+      input_size, batch_size * input_size * output_size,
+      [&](size_t first, size_t last) {
+        if (weight_precision == WeightPrecision::Full) {
+          kernels::gemm(kernels::Transpose::No, kernels::Transpose::No,
+                        batch_size, last - first, output_size, T(1),
+                        dz.data(), dz.stride(), weights.data() + first,
+                        weights.stride(), T(0), dx.data() + first,
+                        dx.stride());
+        } else {
+          kernels::gemm(kernels::Transpose::No, kernels::Transpose::No,
+                        batch_size, last - first, output_size, T(1),
+                        dz.data(), dz.stride(), half_weights.data() + first,
+                        halfFormat(weight_precision), half_weights.stride(),
+                        T(0), dx.data() + first, dx.stride());
+        }
+      });
+}
+
+/*
+ * @brief Weight gradients of a batch, dw = alpha * dz^T * x + beta * dw
+ * @param dz gradients with respect to the weighted sums
+ * @param x inputs of the batch
+ * @param dw output_size x input_size matrix with leading dimension ldw
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::weightGradient(const Matrix<T> &dz,
+                                               const Matrix<T> &x, T alpha,
+                                               T beta, T *dw,
+                                               size_t ldw) const {
+  size_t batch_size = x.rows();
+
+  // split over the neurons, one block of rows of dw each
+  parallel::forRange(output_size, batch_size * input_size * output_size,
+                     [&](size_t first, size_t last) {
+                       kernels::gemm(kernels::Transpose::Yes,
+                                     kernels::Transpose::No, last - first,
+                                     input_size, batch_size, alpha,
+                                     dz.data() + first, dz.stride(), x.data(),
+                                     x.stride(), beta, dw + first * ldw, ldw);
+                     });
+}
+
+/*
+ * @brief Z gradients of a batch from caller buffers, and their sums
+ * @param outputs outputs of the batch
+ * @param output_gradient gradients from previous layers
+ * @param db output_size values set to the sums over the batch (bias
+ * gradients)
+ * @param scratch arena holding the z gradients
+ * @return z gradients: a view into scratch, or of output_gradient for the
+ * identity
+ */
+template <typename T, typename Activation>
+Matrix<T> DenseLayer<T, Activation>::zGradientInto(
+    const Matrix<T> &outputs, const Matrix<T> &output_gradient, T *db,
+    Arena &scratch) const {
+  requireParameters();
+  size_t batch_size = output_gradient.rows();
+
+  // only read by the caller
+  Matrix<T> dz = Matrix<T>::view(const_cast<T *>(output_gradient.data()),
+                                 batch_size, output_size,
+                                 output_gradient.stride());
+  if (!Activation::linear) {
+    dz = Matrix<T>::view(scratch.allocate<T>(batch_size * output_size),
+                         batch_size, output_size, output_size);
+  }
+  std::fill(db, db + output_size, T(0));
+
+  for (size_t n = 0; n < batch_size; n++) {
+    if (!Activation::linear) {
+      Activation::derivative(outputs.row(n), output_gradient.row(n),
+                             dz.row(n), output_size);
+    }
+
+    const T *d = dz.row(n);
+    for (int i = 0; i < output_size; i++) {
+      db[i] += d[i];
+    }
+  }
+  return dz;
+}
+
+/*
+ * @brief Perform backward propagation for the last forwarded batch
+ * @param output_grads gradients from previous layers, one sample per row
+ * @return gradient with respect to the inputs, one sample per row
+ */
+template <typename T, typename Activation>
+const Matrix<T> &
+DenseLayer<T, Activation>::backward(const Matrix<T> &output_gradient) {
+  const Matrix<T> &dz = zGradient(output_gradient);
+
+  // released by backwardAndUpdate
+  if (weight_grads.empty()) {
+    weight_grads.resize(output_size, input_size, 0.0, true);
+  }
+
+  // dW = delta^T * X
+  weightGradient(dz, last_input, T(1), T(0), weight_grads.data(),
+                 weight_grads.stride());
+
+  inputGradient(dz);
+  return input_grads;
+}
+
+/*
+ * @brief Backward propagation fused with a plain gradient descent update
+ * @param output_grads gradients from previous layers, one sample per row
+ * @param learning_rate step size of the update
+ * @return gradient with respect to the inputs, one sample per row
+ */
+template <typename T, typename Activation>
+const Matrix<T> &
+DenseLayer<T, Activation>::backwardAndUpdate(const Matrix<T> &output_gradient,
+                                             T learning_rate) {
+  if (weight_precision != WeightPrecision::Full) {
+    throw std::logic_error("Fused update needs full precision weights");
+  }
+
+  const Matrix<T> &dz = zGradient(output_gradient);
+
+  // dX from the weights before the update
+  inputGradient(dz);
+
+  // W -= learning_rate * delta^T * X, accumulated straight into W
+  weightGradient(dz, last_input, -learning_rate, T(1), weights.data(),
+                 weights.stride());
+  kernels::axpy(biases.storageSize(), -learning_rate, bias_grads.data(),
+                biases.data());
+
+  // the weight gradients are never formed
+  if (!weight_grads.empty()) {
+    weight_grads = Matrix<T>();
+  }
+
+  return input_grads;
+}
+
+/*
+ * @brief Backward propagation fused with a plain gradient descent update
+ * @param output_grads gradients from previous layers
+ * @param learning_rate step size of the update
+ * @return gradient
+ */
+template <typename T, typename Activation>
+vector<T>
+DenseLayer<T, Activation>::backwardAndUpdate(const vector<T> &output_gradient,
+                                             T learning_rate) {
+  Matrix<T> batch;
+  scratch(batch, 1, output_gradient.size());
+  std::copy(output_gradient.begin(), output_gradient.end(), batch.row(0));
+
+  const Matrix<T> &input_gradient = backwardAndUpdate(batch, learning_rate);
+  return vector<T>(input_gradient.row(0),
+                   input_gradient.row(0) + input_gradient.cols());
+}
+
+/*
+ * @brief Backward propagation of a batch forwarded with forwardInto,
+ * applying the SGD update straight to the shared parameters
+ * @param inputs inputs of the batch
+ * @param outputs outputs forwardInto computed for inputs
+ * @param output_grads gradients from previous layers, one sample per row
+ * @param input_grads set to the gradient with respect to the inputs, or
+ * nullptr if not needed
+ * @param learning_rate step size of the update
+ * @param update how the update is written to the parameters
+ * @param scratch arena for the temporaries of the call
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::backwardAndUpdateInto(
+    const Matrix<T> &inputs, const Matrix<T> &outputs,
+    const Matrix<T> &output_gradient, Matrix<T> *input_gradient,
+    T learning_rate, SharedUpdate update, Arena &scratch) {
+  if (weight_precision != WeightPrecision::Full) {
+    throw std::logic_error("Shared update needs full precision weights");
+  }
+
+  // z gradients, and their sums over the batch for the biases
+  T *db = scratch.allocate<T>(output_size);
+  Matrix<T> dz = zGradientInto(outputs, output_gradient, db, scratch);
+
+  // dX from the weights as this thread reads them, before its update
+  if (input_gradient != nullptr) {
+    inputGradientInto(dz, *input_gradient);
+  }
+
+  if (update == SharedUpdate::Racy) {
+    weightGradient(dz, inputs, -learning_rate, T(1), weights.data(),
+                   weights.stride());
+    kernels::axpy(output_size, -learning_rate, db, biases.data());
+    return;
+  }
+
+  // dW is formed first so each weight gets a single atomic add
+  size_t ldw = weights.stride();
+  T *dw = scratch.allocate<T>(output_size * ldw);
+  weightGradient(dz, inputs, T(1), T(0), dw, ldw);
+
+  // row by row, so the padding of the weights is never written
+  for (int i = 0; i < output_size; i++) {
+    kernels::atomicAxpy<T>(input_size, -learning_rate, dw + i * ldw,
+                           weights.row(i));
+  }
+  kernels::atomicAxpy<T>(output_size, -learning_rate, db, biases.data());
+}
+
+/*
+ * @brief Backward propagation of a batch forwarded with forwardInto, into
+ * caller gradient buffers
+ * @param inputs inputs of the batch
+ * @param outputs outputs forwardInto computed for inputs
+ * @param output_grads gradients from previous layers, one sample per row
+ * @param input_grads set to the gradient with respect to the inputs, or
+ * nullptr if not needed
+ * @param weight_grads set to the weight gradients (shape of getWeightGrads)
+ * @param bias_grads set to the bias gradients (shape of getBiasGrads)
+ * @param scratch arena for the temporaries of the call
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::backwardInto(
+    const Matrix<T> &inputs, const Matrix<T> &outputs,
+    const Matrix<T> &output_gradient, Matrix<T> *input_gradient,
+    Matrix<T> &weight_gradient, Matrix<T> &bias_gradient,
+    Arena &scratch) const {
+  if (weight_gradient.rows() != static_cast<size_t>(output_size) ||
+      weight_gradient.cols() != static_cast<size_t>(input_size) ||
+      bias_gradient.cols() != static_cast<size_t>(output_size)) {
+    throw std::invalid_argument(std::string("Gradient shape mismatch in ") +
+                                Activation::name + "Layer");
+  }
+
+  Matrix<T> dz =
+      zGradientInto(outputs, output_gradient, bias_gradient.data(), scratch);
+
+  // dW = delta^T * X
+  weightGradient(dz, inputs, T(1), T(0), weight_gradient.data(),
+                 weight_gradient.stride());
+
+  if (input_gradient != nullptr) {
+    inputGradientInto(dz, *input_gradient);
+  }
+}
+
+/*
+ * @brief Apply the layer's activation function to pre-activation values
+ * @param z weighted sums
+ * @param out output buffer (may alias z)
+ * @param n number of values
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::applyActivation(const T *z, T *out,
+                                                size_t n) const {
+  Activation::apply(z, out, n);
+}
+
+/*
+ * @brief Save weights to a file, tagged with the precision of T
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::saveParams() {
+  std::ofstream file(config_name);
+  Matrix<T> values = getWeights();
+
+  if (file.is_open()) {
+
+    file << std::setprecision(std::numeric_limits<T>::max_digits10);
+    file << dtypeName<T>() << "\n";
+    file << input_size << "\n";
+    file << output_size << "\n";
+
+    for (size_t i = 0; i < values.rows(); i++) {
+      const T *row = values.row(i);
+      for (size_t j = 0; j < values.cols(); j++) {
+        file << row[j] << " ";
+      }
+      file << "\n";
+    }
+    for (size_t j = 0; j < biases.cols(); j++) {
+      file << biases(0, j) << " ";
+    }
+    file.close();
+  }
+}
+
+/*
+ * @brief Initialize weights with download parameters form a file
+ *
+ * The file may hold float32 or float64 values (files without a precision
+ * line are float64); values are converted to T. Throws std::runtime_error
+ * if the file cannot be opened or parsed; the layer is then unchanged.
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::downloadParams() {
+  std::string line;
+  double value;
+  std::ifstream file(config_name);
+
+  if (!file.is_open()) {
+    throw std::runtime_error("Cannot open parameter file " + config_name);
+  }
+
+  std::getline(file, line);
+  if (line == dtypeName<float>() || line == dtypeName<double>()) {
+    std::getline(file, line);
+  }
+  int inputs = parseSize(line, config_name);
+
+  std::getline(file, line);
+  int neurons = parseSize(line, config_name);
+
+  // Parsed into new buffers of exactly the file's shape (allocated zeroed,
+  // so never filled twice) rather than into the old ones, which may be
+  // larger, views of a checkpoint or not allocated at all
+  Matrix<T> loaded_weights;
+  loaded_weights.reshape(neurons, inputs, true);
+
+  // Read weights
+  for (int i = 0; i < neurons; i++) {
+    std::getline(file, line);
+    std::stringstream s(line);
+    T *row = loaded_weights.row(i);
+    int count = 0;
+
+    while (s >> value) {
+      if (count < inputs)
+        row[count] = static_cast<T>(value);
+      count++;
+    }
+
+    // Check size
+    if (count != inputs) {
+      throw std::runtime_error(std::string("Weight size mismatch in ") +
+                               Activation::name + "Layer");
+    }
+  }
+
+  // Read biases
+  Matrix<T> loaded_biases(1, neurons);
+  std::getline(file, line);
+  std::stringstream s(line);
+  int count = 0;
+
+  while (s >> value) {
+    if (count < neurons)
+      loaded_biases(0, count) = static_cast<T>(value);
+    count++;
+  }
+
+  // Check size
+  if (count != neurons) {
+    throw std::runtime_error(std::string("Bias size mismatch in ") +
+                             Activation::name + "Layer");
+  }
+
+  input_size = inputs;
+  output_size = neurons;
+
+  // Keep the configured storage format
+  if (weight_precision == WeightPrecision::Full) {
+    weights = std::move(loaded_weights);
+  } else {
+    half_weights = Matrix<uint16_t>();
+    encodeWeights(loaded_weights, weight_precision, half_weights);
+    weights = Matrix<T>();
+  }
+  biases = std::move(loaded_biases);
+  mapping = nullptr;
+  weight_version = nextWeightVersion();
+
+  if (training) {
+    allocateGrads();
+  }
+}
+
+/*
+ * @brief Add the weights (in their storage format) and biases to a
+ * checkpoint
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::writeParams(
+    checkpoint::Writer &writer) const {
+  if (weight_precision == WeightPrecision::Full) {
+    writer.add(weights);
+  } else {
+    writer.add(half_weights, weight_precision == WeightPrecision::BFloat16
+                                 ? checkpoint::DType::BFloat16
+                                 : checkpoint::DType::Float16);
+  }
+  writer.add(biases);
+}
+
+/*
+ * @brief Take the weights and biases from the next two tensors of a
+ * checkpoint
+ *
+ * Weights saved in another precision than the layer's are converted, and
+ * rounded again if the layer keeps them in 16 bits.
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::readParams(checkpoint::Reader &reader) {
+  const checkpoint::Tensor &stored_weights = reader.read();
+  const checkpoint::Tensor &stored_biases = reader.read();
+  checkTensors(stored_weights, stored_biases);
+
+  checkpoint::DType own = checkpoint::dtypeOf<T>();
+  if (weight_precision == WeightPrecision::BFloat16) {
+    own = checkpoint::DType::BFloat16;
+  } else if (weight_precision == WeightPrecision::Float16) {
+    own = checkpoint::DType::Float16;
+  }
+
+  // In place only with the layout of a padded matrix, which the weight
+  // gradients share. Whatever is not viewed gets a buffer of its own:
+  // weights, half_weights and biases may still view the memory of a
+  // previous checkpoint, released below. (copy always allocates.)
+  bool shared = false;
+  bool padded = stored_weights.stride ==
+                Matrix<T>::paddedStride(stored_weights.cols);
+  if (weight_precision == WeightPrecision::Full) {
+    shared = padded && checkpoint::view(stored_weights, own, weights);
+    if (!shared)
+      checkpoint::copy(stored_weights, weights, true);
+    half_weights = Matrix<uint16_t>();
+  } else {
+    shared = checkpoint::view(stored_weights, own, half_weights);
+    if (!shared) {
+      checkpoint::copy(stored_weights, weights, true);
+      half_weights = Matrix<uint16_t>();
+      encodeWeights(weights, weight_precision, half_weights);
+    }
+    weights = Matrix<T>();
+  }
+
+  if (stored_biases.stride == stored_biases.cols &&
+      checkpoint::view(stored_biases, checkpoint::dtypeOf<T>(), biases)) {
+    shared = true;
+  } else {
+    checkpoint::copy(stored_biases, biases, false);
+  }
+  mapping = shared ? reader.memory() : nullptr;
+  weight_version = nextWeightVersion();
+
+  if (training) {
+    allocateGrads();
+  }
+}
+
+/*
+ * @brief Read the next two tensors and check they fit the layer's shape
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::checkParams(checkpoint::Reader &reader) const {
+  const checkpoint::Tensor &stored_weights = reader.read();
+  const checkpoint::Tensor &stored_biases = reader.read();
+  checkTensors(stored_weights, stored_biases);
+}
+
+/*
+ * @brief Throw if stored weights and biases do not fit the layer's shape
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::checkTensors(
+    const checkpoint::Tensor &stored_weights,
+    const checkpoint::Tensor &stored_biases) const {
+  if (stored_weights.rows != static_cast<size_t>(output_size) ||
+      stored_weights.cols != static_cast<size_t>(input_size)) {
+    throw std::runtime_error(std::string("Weight size mismatch in ") +
+                             Activation::name + "Layer");
+  }
+  if (stored_biases.rows != 1 ||
+      stored_biases.cols != static_cast<size_t>(output_size)) {
+    throw std::runtime_error(std::string("Bias size mismatch in ") +
+                             Activation::name + "Layer");
+  }
+}
+
+/*
+ * @brief Get weight values in the layer
+ * @return weights (widened to T if stored in 16 bits)
+ */
+template <typename T, typename Activation>
+Matrix<T> DenseLayer<T, Activation>::getWeights() const {
+  if (weight_precision == WeightPrecision::Full)
+    return weights;
+  return decodeWeights<T>(half_weights, weight_precision);
+}
+
+/*
+ * @brief Get bias values in the layer
+ * @return biases (single row matrix)
+ */
+template <typename T, typename Activation>
+Matrix<T> DenseLayer<T, Activation>::getBiases() const { return biases; }
+
+/*
+ * @brief Get weight gradient values of the layer
+ * @return weight gradients
+ */
+template <typename T, typename Activation>
+Matrix<T> &DenseLayer<T, Activation>::getWeightGrads() { return weight_grads; };
+
+/*
+ * @brief Get bias gradient values of the layer
+ * @return bias gradients
+ */
+template <typename T, typename Activation>
+Matrix<T> &DenseLayer<T, Activation>::getBiasGrads() { return bias_grads; };
+
+/*
+ * @brief Get the number of parameter tensors (weights and biases)
+ */
+template <typename T, typename Activation>
+size_t DenseLayer<T, Activation>::parameterCount() const {
+  return 2;
+}
+
+/*
+ * @brief Get a view of the weights (index 0) or biases (index 1) and
+ * their gradients
+ */
+template <typename T, typename Activation>
+ParameterView<T> DenseLayer<T, Activation>::parameter(size_t index) {
+  if (index == 0) {
+    T *values =
+        weight_precision == WeightPrecision::Full ? weights.data() : nullptr;
+    return {values, weight_grads.data(), weight_grads.storageSize()};
+  }
+  if (index == 1) {
+    return {biases.data(), bias_grads.data(), biases.storageSize()};
+  }
+  throw std::out_of_range("DenseLayer has two parameter tensors");
+}
+
+/*
+ * @brief Set new values for weights
+ * @param new_weights new values of weights (rounded if stored in 16 bits)
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::setWeights(const Matrix<T> &new_weights) {
+  if (weight_precision == WeightPrecision::Full) {
+    weights.assign(new_weights);
+  } else if (new_weights.rows() != half_weights.rows() ||
+             new_weights.cols() != half_weights.cols()) {
+    throw std::runtime_error(std::string("Weight shape mismatch in ") +
+                             Activation::name + "Layer");
+  } else {
+    encodeWeights(new_weights, weight_precision, half_weights);
+  }
+  weight_version = nextWeightVersion();
+}
+
+/*
+ * @brief Change the storage format of the weights
+ * @param precision new format; converting to 16 bits rounds the weights
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::setWeightPrecision(WeightPrecision precision) {
+  if (precision == weight_precision)
+    return;
+
+  Matrix<T> values = getWeights();
+  weight_precision = precision;
+
+  if (precision == WeightPrecision::Full) {
+    weights = std::move(values);
+    half_weights = Matrix<uint16_t>();
+  } else {
+    encodeWeights(values, precision, half_weights);
+    weights = Matrix<T>();
+  }
+  weight_version = nextWeightVersion();
+}
+
+/*
+ * @brief Get the storage format of the weights
+ */
+template <typename T, typename Activation>
+WeightPrecision DenseLayer<T, Activation>::getWeightPrecision() const {
+  return weight_precision;
+}
+
+/*
+ * @brief Version of the weights, changed by every write through the
+ * layer's methods
+ */
+template <typename T, typename Activation>
+uint64_t DenseLayer<T, Activation>::weightVersion() const {
+  return weight_version;
+}
+
+/*
+ * @brief Set new values for biases
+ * @param new_biases new values of biases
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::setBiases(const Matrix<T> &new_biases) {
+  biases.assign(new_biases);
+}
+
+/*
+ * @brief get the number of input connections
+ * @return number of input connections
+ */
+template <typename T, typename Activation>
+int DenseLayer<T, Activation>::getInputSize() const { return input_size; }
+
+/*
+ * @brief Get the number of output connections
+ * @return number of output connections
+ */
+template <typename T, typename Activation>
+int DenseLayer<T, Activation>::getOutputSize() const { return output_size; };
+
+/*
+ * @brief Copy the parameters into a new layer in evaluation mode
+ * @return layer whose buffers are first touched by the calling thread
+ */
+template <typename T, typename Activation>
+std::unique_ptr<Layer<T>> DenseLayer<T, Activation>::replicate() const {
+  std::unique_ptr<DenseLayer> replica(new DenseLayer());
+  replica->input_size = input_size;
+  replica->output_size = output_size;
+  replica->config_name = config_name;
+  replica->weight_precision = weight_precision;
+  replica->weights = weights;
+  replica->half_weights = half_weights;
+  replica->biases = biases;
+  return replica;
+}
+
+/*
+ * @brief Overwrite the parameters with those of a layer of the same type
+ * @param source layer this one was replicated from
+ */
+template <typename T, typename Activation>
+void DenseLayer<T, Activation>::copyParameters(const Layer<T> &source) {
+  const DenseLayer *dense = dynamic_cast<const DenseLayer *>(&source);
+  if (dense == nullptr || dense->input_size != input_size ||
+      dense->output_size != output_size ||
+      dense->weight_precision != weight_precision) {
+    throw std::invalid_argument(std::string("Parameter source mismatch in ") +
+                                Activation::name + "Layer");
+  }
+
+  if (weight_precision == WeightPrecision::Full) {
+    weights.assign(dense->weights);
+  } else {
+    half_weights.assign(dense->half_weights);
+  }
+  biases.assign(dense->biases);
+  weight_version = nextWeightVersion();
+}
+
+/*
+ * @brief Name of the layer type in model archives and the Registry
+ */
+template <typename T, typename Activation>
+std::string DenseLayer<T, Activation>::typeName() const {
+  return std::string(Activation::name) + "Layer";
+}
+
+template class DenseLayer<float, activation::ReLU>;
+template class DenseLayer<double, activation::ReLU>;
+template class DenseLayer<float, activation::LeakyReLU>;
+template class DenseLayer<double, activation::LeakyReLU>;
+template class DenseLayer<float, activation::Sigmoid>;
+template class DenseLayer<double, activation::Sigmoid>;
+template class DenseLayer<float, activation::Tanh>;
+template class DenseLayer<double, activation::Tanh>;
+template class DenseLayer<float, activation::Identity>;
+template class DenseLayer<double, activation::Identity>;
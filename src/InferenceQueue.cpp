@@ -0,0 +1,133 @@
+#include "../include/InferenceQueue.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+/*
+ * @brief Start the batching worker
+ * @param model model to serve
+ * @param max_batch largest number of requests per forward
+ * @param max_wait longest time the oldest request waits for a full batch
+ */
+template <typename T>
+InferenceQueue<T>::InferenceQueue(const SequentialModel<T> &model,
+                                  size_t max_batch,
+                                  std::chrono::microseconds max_wait)
+    : model(model), max_batch(max_batch), max_wait(max_wait),
+      stopping(false) {
+  if (max_batch < 1) {
+    throw std::invalid_argument("Batch size must be positive");
+  }
+
+  running.reserve(max_batch);
+  batch.resize(max_batch, model.getInputSize());
+  worker = std::thread(&InferenceQueue<T>::run, this);
+}
+
+/*
+ * @brief Run the requests still queued, then stop the worker
+ */
+template <typename T> InferenceQueue<T>::~InferenceQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  ready.notify_one();
+  worker.join();
+}
+
+/*
+ * @brief Queue one prediction
+ * @param input input data (features) of one sample
+ * @return future output of the model
+ */
+template <typename T>
+std::future<vector<T>> InferenceQueue<T>::submit(vector<T> input) {
+  if (input.size() != static_cast<size_t>(model.getInputSize())) {
+    throw std::invalid_argument("Input size mismatch in InferenceQueue");
+  }
+
+  Request request;
+  request.input = std::move(input);
+  request.arrival = std::chrono::steady_clock::now();
+  std::future<vector<T>> result = request.result.get_future();
+
+  size_t queued;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(request));
+    queued = pending.size();
+  }
+
+  // the worker sleeps until the first request, then until the batch is
+  // full or its deadline passes
+  if (queued == 1 || queued == max_batch) {
+    ready.notify_one();
+  }
+  return result;
+}
+
+/*
+ * @brief Collect batches and fulfill their requests until stopped
+ */
+template <typename T> void InferenceQueue<T>::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    ready.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (pending.empty())
+      return;
+
+    // Wait for the batch to fill, at most until the oldest request is due
+    std::chrono::steady_clock::time_point deadline =
+        pending.front().arrival + max_wait;
+    ready.wait_until(lock, deadline, [this] {
+      return stopping || pending.size() >= max_batch;
+    });
+
+    size_t count = std::min(max_batch, pending.size());
+    for (size_t i = 0; i < count; i++) {
+      running.push_back(std::move(pending.front()));
+      pending.pop_front();
+    }
+
+    // Clients keep queueing while the batch runs
+    lock.unlock();
+    runBatch();
+    running.clear();
+    lock.lock();
+  }
+}
+
+/*
+ * @brief Run one forward for the requests in running
+ */
+template <typename T> void InferenceQueue<T>::runBatch() {
+  try {
+    // batch keeps its max_batch rows of capacity, so this never allocates
+    batch.reshape(running.size(), model.getInputSize());
+    for (size_t n = 0; n < running.size(); n++) {
+      std::copy(running[n].input.begin(), running[n].input.end(),
+                batch.row(n));
+    }
+
+    Matrix<T> outputs = model.predict(batch, scratch);
+
+    for (size_t n = 0; n < running.size(); n++) {
+      running[n].result.set_value(
+          vector<T>(outputs.row(n), outputs.row(n) + outputs.cols()));
+    }
+  } catch (...) {
+    for (Request &request : running) {
+      try {
+        request.result.set_exception(std::current_exception());
+      } catch (const std::future_error &) {
+        // already fulfilled before the failure
+      }
+    }
+  }
+}
+
+template class InferenceQueue<float>;
+template class InferenceQueue<double>;
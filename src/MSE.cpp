@@ -1,4 +1,6 @@
 #include "../include/loss/MSE.h"
+#include <cstddef>
+#include <stdexcept>
 #include <vector>
 
 using std::vector;
@@ -8,10 +10,10 @@ using std::vector;
  * @param prediction - output value of model
  * @param target - target value for output
  */
-double MSE::computeLoss(vector<double> &prediction,
-                        const vector<double> &target) {
-  double error = 0;
-  double loss = 0;
+template <typename T>
+T MSE<T>::computeLoss(vector<T> &prediction, const vector<T> &target) {
+  T error = 0;
+  T loss = 0;
 
   this->prediction = prediction;
   this->target = target;
@@ -27,12 +29,127 @@ double MSE::computeLoss(vector<double> &prediction,
 /*
  * @brief Compute gradient in respect to loss function input values
  */
-vector<double> MSE::computeGrad() {
-  vector<double> gradient(prediction.size());
+template <typename T> vector<T> MSE<T>::computeGrad() {
+  vector<T> gradient(prediction.size());
 
   for (size_t i = 0; i < prediction.size(); i++) {
-    gradient[i] = 2.0 * (prediction[i] - target[i]) / prediction.size();
+    gradient[i] = T(2) * (prediction[i] - target[i]) / prediction.size();
   }
 
   return gradient;
 };
+
+/*
+ * @brief Take the batch gradient from an arena (nullptr: owned buffer)
+ */
+template <typename T> void MSE<T>::setArena(Arena *new_arena) {
+  arena = new_arena;
+  batch_prediction = Matrix<T>();
+  batch_target = Matrix<T>();
+  batch_gradient = Matrix<T>();
+}
+
+/*
+ * @brief Check shapes and compute loss averaged over a batch
+ * @param predictions output values of model, one sample per row
+ * @param targets target values for output, one sample per row
+ */
+template <typename T>
+T MSE<T>::computeLoss(const Matrix<T> &predictions,
+                      const Matrix<T> &targets) {
+  T loss = evaluate(predictions, targets);
+
+  if (arena != nullptr) {
+    // only read, and alive until computeBatchGrad (see Loss::setArena)
+    batch_prediction = Matrix<T>::view(const_cast<T *>(predictions.data()),
+                                       predictions.rows(), predictions.cols(),
+                                       predictions.stride());
+    batch_target =
+        Matrix<T>::view(const_cast<T *>(targets.data()), targets.rows(),
+                        targets.cols(), targets.stride());
+  } else {
+    batch_prediction = predictions;
+    batch_target = targets;
+  }
+
+  return loss;
+}
+
+/*
+ * @brief Compute the loss averaged over a batch without keeping anything
+ * for the gradient
+ * @param predictions output values of model, one sample per row
+ * @param targets target values for output, one sample per row
+ */
+template <typename T>
+T MSE<T>::evaluate(const Matrix<T> &predictions,
+                   const Matrix<T> &targets) const {
+  if (predictions.rows() != targets.rows() ||
+      predictions.cols() != targets.cols()) {
+    throw std::runtime_error("Prediction and target shapes mismatch in MSE");
+  }
+
+  T loss = 0;
+
+  for (size_t n = 0; n < predictions.rows(); n++) {
+    const T *p = predictions.row(n);
+    const T *t = targets.row(n);
+
+    for (size_t i = 0; i < predictions.cols(); i++) {
+      T error = p[i] - t[i];
+      loss += error * error;
+    }
+  }
+
+  return loss / (predictions.rows() * predictions.cols());
+}
+
+/*
+ * @brief Compute gradient for the last batch, averaged over its samples
+ * @return gradient, one sample per row
+ */
+template <typename T> const Matrix<T> &MSE<T>::computeBatchGrad() {
+  size_t batch_size = batch_prediction.rows();
+  size_t output_size = batch_prediction.cols();
+  Matrix<T> &gradient = batch_gradient;
+  if (arena != nullptr) {
+    gradient = Matrix<T>::view(arena->allocate<T>(batch_size * output_size),
+                               batch_size, output_size, output_size);
+  } else {
+    gradient.reshape(batch_size, output_size);
+  }
+
+  gradientInto(batch_prediction, batch_target, gradient);
+  return gradient;
+}
+
+/*
+ * @brief Compute the batch gradient into a caller matrix without keeping
+ * anything
+ * @param predictions output values of model, one sample per row
+ * @param targets target values for output, one sample per row
+ * @param gradient matrix of the shape of predictions, overwritten
+ */
+template <typename T>
+void MSE<T>::gradientInto(const Matrix<T> &predictions,
+                          const Matrix<T> &targets,
+                          Matrix<T> &gradient) const {
+  size_t batch_size = predictions.rows();
+  size_t output_size = predictions.cols();
+  T scale = T(2) / (batch_size * output_size);
+
+  for (size_t n = 0; n < batch_size; n++) {
+    const T *p = predictions.row(n);
+    const T *t = targets.row(n);
+    T *g = gradient.row(n);
+
+    for (size_t i = 0; i < output_size; i++) {
+      g[i] = scale * (p[i] - t[i]);
+    }
+  }
+}
+
+template <typename T> std::string MSE<T>::typeName() const { return "MSE"; }
+
+template class MSE<float>;
+template class MSE<double>;
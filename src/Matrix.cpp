@@ -0,0 +1,201 @@
+#include "../include/Matrix.h"
+#include "../include/Memory.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/*
+ * @brief Allocate zeroed aligned storage for count values
+ */
+template <typename T> T *alignedAlloc(size_t count) {
+  return static_cast<T *>(
+      memory::allocate(count * sizeof(T), Matrix<T>::alignment));
+}
+
+} // namespace
+
+template <typename T>
+Matrix<T>::Matrix()
+    : storage(nullptr), n_rows(0), n_cols(0), row_stride(0), capacity(0),
+      owned(true) {}
+
+template <typename T>
+Matrix<T>::Matrix(size_t rows, size_t cols, T value, bool padded)
+    : storage(nullptr), n_rows(0), n_cols(0), row_stride(0), capacity(0),
+      owned(true) {
+  allocate(rows, cols, padded);
+  fill(value);
+}
+
+/*
+ * @brief Round a row length up to a whole number of 64-byte lines
+ */
+template <typename T> size_t Matrix<T>::paddedStride(size_t cols) {
+  const size_t per_line = alignment / sizeof(T);
+  return (cols + per_line - 1) / per_line * per_line;
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::view(T *data, size_t rows, size_t cols, size_t stride) {
+  Matrix matrix;
+  matrix.storage = data;
+  matrix.n_rows = rows;
+  matrix.n_cols = cols;
+  matrix.row_stride = stride;
+  matrix.owned = false;
+  return matrix;
+}
+
+template <typename T>
+Matrix<T>::Matrix(const Matrix &other)
+    : storage(nullptr), n_rows(other.n_rows), n_cols(other.n_cols),
+      row_stride(other.row_stride), capacity(other.storageSize()),
+      owned(true) {
+  storage = alignedAlloc<T>(capacity);
+  if (storage != nullptr)
+    std::memcpy(storage, other.storage, storageSize() * sizeof(T));
+}
+
+template <typename T>
+Matrix<T>::Matrix(Matrix &&other) noexcept
+    : storage(other.storage), n_rows(other.n_rows), n_cols(other.n_cols),
+      row_stride(other.row_stride), capacity(other.capacity),
+      owned(other.owned) {
+  other.storage = nullptr;
+  other.n_rows = other.n_cols = other.row_stride = other.capacity = 0;
+  other.owned = true;
+}
+
+template <typename T>
+Matrix<T> &Matrix<T>::operator=(const Matrix &other) {
+  if (this == &other)
+    return *this;
+
+  // Reuse the buffer when the copy fits in it
+  if (owned && other.storageSize() <= capacity) {
+    size_t old_size = storageSize();
+    n_rows = other.n_rows;
+    n_cols = other.n_cols;
+    row_stride = other.row_stride;
+    if (storage != nullptr) {
+      std::memcpy(storage, other.storage, storageSize() * sizeof(T));
+      // values past the copy stay zero, like a fresh allocation
+      if (old_size > storageSize())
+        std::memset(storage + storageSize(), 0,
+                    (old_size - storageSize()) * sizeof(T));
+    }
+    return *this;
+  }
+
+  Matrix copy(other);
+  *this = std::move(copy);
+  return *this;
+}
+
+template <typename T>
+Matrix<T> &Matrix<T>::operator=(Matrix &&other) noexcept {
+  if (this != &other) {
+    release();
+    storage = other.storage;
+    n_rows = other.n_rows;
+    n_cols = other.n_cols;
+    row_stride = other.row_stride;
+    capacity = other.capacity;
+    owned = other.owned;
+    other.storage = nullptr;
+    other.n_rows = other.n_cols = other.row_stride = other.capacity = 0;
+    other.owned = true;
+  }
+  return *this;
+}
+
+template <typename T> Matrix<T>::~Matrix() { release(); }
+
+template <typename T>
+void Matrix<T>::allocate(size_t rows, size_t cols, bool padded) {
+  size_t stride = padded ? paddedStride(cols) : cols;
+
+  if (owned && rows * stride <= capacity) {
+    // zero the used part so the padding of the new shape is clear
+    if (storage != nullptr)
+      std::memset(storage, 0, std::max(storageSize(), rows * stride) *
+                                  sizeof(T));
+  } else {
+    release();
+    capacity = rows * stride;
+    storage = alignedAlloc<T>(capacity);
+  }
+  n_rows = rows;
+  n_cols = cols;
+  row_stride = stride;
+}
+
+template <typename T> void Matrix<T>::release() {
+  if (owned)
+    std::free(storage);
+  storage = nullptr;
+  n_rows = n_cols = row_stride = capacity = 0;
+  owned = true;
+}
+
+/*
+ * @brief Give the matrix a new shape, all values set to value
+ */
+template <typename T>
+void Matrix<T>::resize(size_t rows, size_t cols, T value, bool padded) {
+  allocate(rows, cols, padded);
+  fill(value);
+}
+
+/*
+ * @brief Give the matrix a new shape without initializing its values
+ */
+template <typename T>
+void Matrix<T>::reshape(size_t rows, size_t cols, bool padded) {
+  size_t stride = padded ? paddedStride(cols) : cols;
+  if (rows == n_rows && cols == n_cols && stride == row_stride)
+    return;
+  allocate(rows, cols, padded);
+}
+
+/*
+ * @brief Set every element (padding excluded) to value
+ */
+template <typename T> void Matrix<T>::fill(T value) {
+  for (size_t i = 0; i < n_rows; i++) {
+    T *r = row(i);
+    for (size_t j = 0; j < n_cols; j++) {
+      r[j] = value;
+    }
+  }
+}
+
+/*
+ * @brief Copy values from a matrix of the same shape (strides may differ)
+ */
+template <typename T> void Matrix<T>::assign(const Matrix &other) {
+  if (other.n_rows != n_rows || other.n_cols != n_cols) {
+    throw std::runtime_error("Matrix shape mismatch in assign");
+  }
+
+  if (other.row_stride == row_stride) {
+    std::memcpy(storage, other.storage, storageSize() * sizeof(T));
+    return;
+  }
+
+  for (size_t i = 0; i < n_rows; i++) {
+    std::memcpy(row(i), other.row(i), n_cols * sizeof(T));
+  }
+}
+
+template class Matrix<float>;
+template class Matrix<double>;
+template class Matrix<int8_t>;
+template class Matrix<int32_t>;
+template class Matrix<uint16_t>;
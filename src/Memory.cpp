@@ -0,0 +1,130 @@
+#include "../include/Memory.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace memory {
+
+namespace {
+std::atomic<bool> huge_pages(false);
+} // namespace
+
+void setHugePages(bool enabled) {
+  huge_pages.store(enabled, std::memory_order_relaxed);
+}
+
+bool hugePages() { return huge_pages.load(std::memory_order_relaxed); }
+
+/*
+ * @brief Allocate zeroed memory, released with std::free
+ */
+void *allocate(size_t bytes, size_t alignment) {
+  if (bytes == 0)
+    return nullptr;
+
+  bool huge = hugePages() && bytes >= huge_page_size;
+  if (huge)
+    alignment = std::max(alignment, huge_page_size);
+
+  // aligned_alloc needs a multiple of the alignment
+  bytes = (bytes + alignment - 1) / alignment * alignment;
+
+  void *ptr = std::aligned_alloc(alignment, bytes);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // advise before the first touch so the pages are faulted in as huge pages
+  if (huge)
+    madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+
+  std::memset(ptr, 0, bytes);
+  return ptr;
+}
+
+} // namespace memory
+
+Arena::Arena(size_t initial_bytes)
+    : offset(0), used_bytes(0), peak_bytes(0) {
+  if (initial_bytes > 0)
+    addBlock(initial_bytes);
+}
+
+Arena::~Arena() {
+  for (Block &block : blocks) {
+    std::free(block.data);
+  }
+}
+
+void Arena::addBlock(size_t bytes) {
+  bytes = (bytes + alignment - 1) / alignment * alignment;
+  char *data = static_cast<char *>(memory::allocate(bytes, alignment));
+  blocks.push_back({data, bytes});
+  offset = 0;
+}
+
+/*
+ * @brief Get uninitialized storage of the given size, 64-byte aligned
+ */
+void *Arena::allocateBytes(size_t bytes) {
+  bytes = (bytes + alignment - 1) / alignment * alignment;
+
+  if (blocks.empty() || offset + bytes > blocks.back().size) {
+    // at least double the arena so that growth steps stay rare
+    addBlock(std::max(bytes, capacity()));
+  }
+
+  void *ptr = blocks.back().data + offset;
+  offset += bytes;
+  used_bytes += bytes;
+  peak_bytes = std::max(peak_bytes, used_bytes);
+  return ptr;
+}
+
+/*
+ * @brief Release everything allocated since the last reset
+ */
+void Arena::reset() {
+  // Merge the blocks of a step that overflowed, so the next one fits in one
+  if (blocks.size() > 1) {
+    size_t total = capacity();
+    for (Block &block : blocks) {
+      std::free(block.data);
+    }
+    blocks.clear();
+    addBlock(total);
+  }
+  offset = 0;
+  used_bytes = 0;
+}
+
+/*
+ * @brief Free every block, for when the next steps need less memory
+ */
+void Arena::release() {
+  for (Block &block : blocks) {
+    std::free(block.data);
+  }
+  blocks.clear();
+  offset = 0;
+  used_bytes = 0;
+  peak_bytes = 0;
+}
+
+/*
+ * @brief Total size of the blocks owned by the arena
+ */
+size_t Arena::capacity() const {
+  size_t total = 0;
+  for (const Block &block : blocks) {
+    total += block.size;
+  }
+  return total;
+}
@@ -0,0 +1,198 @@
+#include "../include/Numa.h"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef EASYLEARN_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+namespace numa {
+
+namespace {
+
+/*
+ * @brief Parse a kernel list such as "0-3,8,10-11"
+ */
+std::vector<int> parseList(const std::string &text) {
+  std::vector<int> values;
+  std::stringstream stream(text);
+  std::string range;
+
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n")
+      continue;
+    size_t dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int value = first; value <= last; value++) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+/*
+ * @brief Read a list file of /sys, empty if missing
+ */
+std::vector<int> readList(const std::string &path) {
+  std::ifstream file(path);
+  std::string text;
+  if (!file || !std::getline(file, text))
+    return {};
+  return parseList(text);
+}
+
+/*
+ * @brief Ids of the online nodes, read once
+ */
+const std::vector<int> &nodeIds() {
+  static const std::vector<int> ids = [] {
+    std::vector<int> found;
+#ifdef EASYLEARN_LIBNUMA
+    if (numa_available() >= 0) {
+      for (int node = 0; node <= numa_max_node(); node++) {
+        if (numa_bitmask_isbitset(numa_nodes_ptr, node))
+          found.push_back(node);
+      }
+    }
+#elif defined(__linux__)
+    found = readList("/sys/devices/system/node/online");
+#endif
+    if (found.empty())
+      found.push_back(0);
+    return found;
+  }();
+  return ids;
+}
+
+#ifdef __linux__
+/*
+ * @brief Set the affinity of the calling thread
+ */
+bool setAffinity(const std::vector<int> &allowed) {
+  if (allowed.empty())
+    return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : allowed) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+#endif
+
+} // namespace
+
+size_t nodes() { return nodeIds().size(); }
+
+std::vector<int> cpus(size_t node) {
+  if (node >= nodes())
+    return {};
+  int id = nodeIds()[node];
+
+#ifdef EASYLEARN_LIBNUMA
+  std::vector<int> found;
+  if (numa_available() >= 0) {
+    struct bitmask *mask = numa_allocate_cpumask();
+    if (numa_node_to_cpus(id, mask) == 0) {
+      for (unsigned cpu = 0; cpu < mask->size; cpu++) {
+        if (numa_bitmask_isbitset(mask, cpu))
+          found.push_back(static_cast<int>(cpu));
+      }
+    }
+    numa_free_cpumask(mask);
+  }
+  return found;
+#elif defined(__linux__)
+  return readList("/sys/devices/system/node/node" + std::to_string(id) +
+                  "/cpulist");
+#else
+  (void)id;
+  return {};
+#endif
+}
+
+std::vector<int> allowedCpus() {
+  std::vector<int> allowed;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set))
+        allowed.push_back(cpu);
+    }
+  }
+#endif
+  return allowed;
+}
+
+bool pinThread(size_t node) {
+#ifdef __linux__
+  if (!setAffinity(cpus(node)))
+    return false;
+#ifdef EASYLEARN_LIBNUMA
+  // allocate on the node even where first touch would not
+  numa_set_preferred(nodeIds()[node]);
+#endif
+  return true;
+#else
+  (void)node;
+  return false;
+#endif
+}
+
+AffinityGuard::AffinityGuard() : saved(allowedCpus()) {}
+
+AffinityGuard::~AffinityGuard() {
+#ifdef __linux__
+  setAffinity(saved);
+#ifdef EASYLEARN_LIBNUMA
+  // pinThread preferred the node; back to the default local allocation
+  numa_set_localalloc();
+#endif
+#endif
+}
+
+int nodeOf(const void *address) {
+#ifdef __linux__
+  // move_pages without target nodes only reports where the page is
+  void *page = reinterpret_cast<void *>(
+      reinterpret_cast<uintptr_t>(address) &
+      ~static_cast<uintptr_t>(sysconf(_SC_PAGESIZE) - 1));
+  int status = -1;
+#ifdef EASYLEARN_LIBNUMA
+  if (move_pages(0, 1, &page, nullptr, &status, 0) != 0)
+    return -1;
+#else
+  if (syscall(SYS_move_pages, 0, 1UL, &page, nullptr, &status, 0) != 0)
+    return -1;
+#endif
+  if (status < 0)
+    return -1;
+
+  // report the index among the online nodes, like the other calls
+  for (size_t node = 0; node < nodes(); node++) {
+    if (nodeIds()[node] == status)
+      return static_cast<int>(node);
+  }
+  return -1;
+#else
+  (void)address;
+  return -1;
+#endif
+}
+
+} // namespace numa
@@ -0,0 +1,123 @@
+#include "../include/layers/QuantizedLayer.h"
+#include "../include/kernels/Gemm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+namespace {
+
+const int quant_max = 127; // symmetric int8 range [-127, 127]
+
+/*
+ * @brief Round value / scale to the nearest int8 step, saturating
+ */
+template <typename T> int8_t quantizeValue(T value, T inverse_scale) {
+  long q = std::lround(value * inverse_scale);
+  return static_cast<int8_t>(
+      std::min<long>(quant_max, std::max<long>(-quant_max, q)));
+}
+
+} // namespace
+
+template <typename T>
+QuantizedLayer<T>::QuantizedLayer(const Layer<T> &layer, T max_input)
+    : source(&layer) {
+  Matrix<T> float_weights = layer.getWeights();
+  Matrix<T> float_biases = layer.getBiases();
+  size_t output_size = float_weights.rows();
+  size_t input_size = float_weights.cols();
+
+  input_scale = max_input > T(0) ? max_input / quant_max : T(1);
+  weights.resize(output_size, input_size);
+  output_scales.resize(output_size);
+  biases.assign(float_biases.row(0), float_biases.row(0) + output_size);
+
+  for (size_t i = 0; i < output_size; i++) {
+    const T *row = float_weights.row(i);
+    T max_weight = 0;
+
+    for (size_t j = 0; j < input_size; j++) {
+      max_weight = std::max(max_weight, std::fabs(row[j]));
+    }
+
+    T scale = max_weight > T(0) ? max_weight / quant_max : T(1);
+    int8_t *q = weights.row(i);
+    for (size_t j = 0; j < input_size; j++) {
+      q[j] = quantizeValue(row[j], T(1) / scale);
+    }
+    output_scales[i] = input_scale * scale;
+  }
+}
+
+/*
+ * @brief Perform forward propagation for a batch of samples
+ * @param inputs batch of input data, one sample per row
+ * @return output data of this layer, one sample per row
+ */
+template <typename T>
+Matrix<T> QuantizedLayer<T>::forward(const Matrix<T> &inputs) const {
+  size_t batch_size = inputs.rows();
+  size_t input_size = weights.cols();
+  size_t output_size = weights.rows();
+  Matrix<int8_t> quantized(batch_size, input_size, 0, true);
+  Matrix<int32_t> sums(batch_size, output_size);
+  Matrix<T> outputs(batch_size, output_size);
+
+  // Quantize inputs with the calibrated scale
+  T inverse_scale = T(1) / input_scale;
+  for (size_t n = 0; n < batch_size; n++) {
+    const T *x = inputs.row(n);
+    int8_t *q = quantized.row(n);
+    for (size_t j = 0; j < input_size; j++) {
+      q[j] = quantizeValue(x[j], inverse_scale);
+    }
+  }
+
+  // Z_q = X_q * W_q^T in int32
+  kernels::gemmInt8(batch_size, output_size, input_size, quantized.data(),
+                    quantized.stride(), weights.data(), weights.stride(),
+                    sums.data(), sums.stride());
+
+  // Dequantize Z = Z_q * scales + b and apply the activation
+  for (size_t n = 0; n < batch_size; n++) {
+    const int32_t *s = sums.row(n);
+    T *z = outputs.row(n);
+    for (size_t i = 0; i < output_size; i++) {
+      z[i] = T(s[i]) * output_scales[i] + biases[i];
+    }
+  }
+  source->applyActivation(outputs.data(), outputs.data(),
+                          outputs.storageSize());
+
+  return outputs;
+}
+
+/*
+ * @brief Get the number of bytes held by the quantized parameters
+ */
+template <typename T> size_t QuantizedLayer<T>::parameterBytes() const {
+  return weights.storageSize() * sizeof(int8_t) +
+         (output_scales.size() + biases.size()) * sizeof(T);
+}
+
+/*
+ * @brief Get the number of input connections
+ * @return number of input connections
+ */
+template <typename T> int QuantizedLayer<T>::getInputSize() const {
+  return weights.cols();
+}
+
+/*
+ * @brief Get the number of output connections
+ * @return number of output connections
+ */
+template <typename T> int QuantizedLayer<T>::getOutputSize() const {
+  return weights.rows();
+}
+
+template class QuantizedLayer<float>;
+template class QuantizedLayer<double>;
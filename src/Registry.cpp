@@ -0,0 +1,102 @@
+#include "../include/Registry.h"
+#include "../include/layers/DenseLayer.h"
+#include "../include/loss/MSE.h"
+#include "../include/optimizers/SGD.h"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+/*
+ * @brief Factories of one scalar type, with the built-in types
+ */
+template <typename T> struct Factories {
+  std::mutex mutex; // guards the maps: types may be added while loading
+  std::map<std::string, typename Registry<T>::LayerFactory> layers;
+  std::map<std::string, typename Registry<T>::LossFactory> losses;
+  std::map<std::string, typename Registry<T>::OptimizerFactory> optimizers;
+
+  template <typename Activation> void addDense() {
+    layers[std::string(Activation::name) + "Layer"] = [](int input,
+                                                          int output) {
+      return std::make_unique<DenseLayer<T, Activation>>(
+          input, output, "", ParameterInit::Deferred);
+    };
+  }
+
+  Factories() {
+    addDense<activation::ReLU>();
+    addDense<activation::LeakyReLU>();
+    addDense<activation::Sigmoid>();
+    addDense<activation::Tanh>();
+    addDense<activation::Identity>();
+    losses["MSE"] = [] { return std::make_unique<MSE<T>>(); };
+    optimizers["SGD"] = [] { return std::make_unique<SGD<T>>(T(0)); };
+  }
+};
+
+template <typename T> Factories<T> &factories() {
+  static Factories<T> registered;
+  return registered;
+}
+
+/*
+ * @brief Find a factory by name
+ * @param kind what the factory creates, for the error message
+ */
+template <typename Map>
+typename Map::mapped_type find(std::mutex &mutex, const Map &map,
+                               const std::string &type, const char *kind) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = map.find(type);
+  if (found == map.end()) {
+    throw std::invalid_argument(std::string("Unknown ") + kind + " type " +
+                                type);
+  }
+  return found->second;
+}
+
+} // namespace
+
+template <typename T>
+void Registry<T>::addLayer(const std::string &type, LayerFactory factory) {
+  std::lock_guard<std::mutex> lock(factories<T>().mutex);
+  factories<T>().layers[type] = std::move(factory);
+}
+
+template <typename T>
+void Registry<T>::addLoss(const std::string &type, LossFactory factory) {
+  std::lock_guard<std::mutex> lock(factories<T>().mutex);
+  factories<T>().losses[type] = std::move(factory);
+}
+
+template <typename T>
+void Registry<T>::addOptimizer(const std::string &type,
+                               OptimizerFactory factory) {
+  std::lock_guard<std::mutex> lock(factories<T>().mutex);
+  factories<T>().optimizers[type] = std::move(factory);
+}
+
+template <typename T>
+std::unique_ptr<Layer<T>> Registry<T>::createLayer(const std::string &type,
+                                                   int input, int output) {
+  Factories<T> &all = factories<T>();
+  return find(all.mutex, all.layers, type, "layer")(input, output);
+}
+
+template <typename T>
+std::unique_ptr<Loss<T>> Registry<T>::createLoss(const std::string &type) {
+  Factories<T> &all = factories<T>();
+  return find(all.mutex, all.losses, type, "loss")();
+}
+
+template <typename T>
+std::unique_ptr<Optimizer<T>>
+Registry<T>::createOptimizer(const std::string &type) {
+  Factories<T> &all = factories<T>();
+  return find(all.mutex, all.optimizers, type, "optimizer")();
+}
+
+template class Registry<float>;
+template class Registry<double>;
@@ -1,28 +1,135 @@
 #include "../include/optimizers/SGD.h"
+#include "../include/kernels/Gemm.h"
+#include <cstddef>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
 
-SGD::SGD(float lr) : learning_rate(lr) {}
+template <typename T> SGD<T>::SGD(T lr) : learning_rate(lr) {}
 
 /*
  * @brief Correct weights
  * @param layer pointer to the layer object
  */
-void SGD::step(Layer &layer) {
-  int input_size = layer.getInputSize();
-  int output_size = layer.getOutputSize();
+template <typename T> void SGD<T>::step(Layer<T> &layer) {
+  for (size_t i = 0; i < layer.parameterCount(); i++) {
+    ParameterView<T> param = layer.parameter(i);
 
-  vector<vector<double>> weights = layer.getWeights();
-  vector<double> biases = layer.getBiases();
-
-  vector<vector<double>> &weight_grads = layer.getWeightGrads();
-  vector<double> &biase_grads = layer.getBiasGrads();
+    // Parameters and their gradients share shape and padding, so both
+    // buffers can be swept linearly and updated in place
+    if (param.values != nullptr) {
+      kernels::axpy(param.size, -learning_rate, param.grads, param.values);
+      continue;
+    }
 
-  for (int i = 0; i < output_size; i++) {
-    for (int j = 0; j < input_size; j++) {
-      weights[i][j] -= learning_rate * weight_grads[i][j];
+    // 16-bit weights: update the full-precision master copy and round it
+    // back into the layer. The copy is taken again from the layer when its
+    // weights were written since the last step (set, loaded, precision
+    // changed) or it is a new layer at the address of a destroyed one.
+    MasterCopy &master = master_weights[&layer];
+    if (master.version != layer.weightVersion()) {
+      master.weights = layer.getWeights();
     }
-    biases[i] -= learning_rate * biase_grads[i];
+    kernels::axpy(param.size, -learning_rate, param.grads,
+                  master.weights.data());
+    layer.setWeights(master.weights);
+    master.version = layer.weightVersion();
+  }
+
+  if (layer.getWeightPrecision() == WeightPrecision::Full) {
+    master_weights.erase(&layer);
+  }
+}
+
+/*
+ * @brief Drop the master copy of a layer's weights
+ */
+template <typename T> void SGD<T>::resetState(const Layer<T> &layer) {
+  master_weights.erase(&layer);
+}
+
+/*
+ * @brief Master copy of a layer's weights if it is current, else null
+ */
+template <typename T>
+const typename SGD<T>::MasterCopy *
+SGD<T>::currentMaster(const Layer<T> &layer) const {
+  auto found = master_weights.find(&layer);
+  if (found == master_weights.end() ||
+      found->second.version != layer.weightVersion() ||
+      layer.getWeightPrecision() == WeightPrecision::Full) {
+    return nullptr;
   }
+  return &found->second;
+}
 
-  layer.setWeights(weights);
-  layer.setBiases(biases);
+/*
+ * @brief SGD is a plain update and can always be fused
+ * @param learning_rate set to the optimizer's learning rate
+ */
+template <typename T> bool SGD<T>::fusedLearningRate(T &learning_rate) const {
+  learning_rate = this->learning_rate;
+  return true;
 }
+
+template <typename T> std::string SGD<T>::typeName() const { return "SGD"; }
+
+/*
+ * @brief Save the learning rate and the master copies of 16-bit weights
+ *
+ * The config line is the learning rate, the number of master copies and
+ * the index of the layer of each; the copies follow as tensors.
+ */
+template <typename T>
+void SGD<T>::saveState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                       std::ostream &config,
+                       checkpoint::Writer &writer) const {
+  // stale copies are not saved: the next step would drop them anyway
+  vector<size_t> kept;
+  for (size_t i = 0; i < layers.size(); i++) {
+    if (currentMaster(*layers[i]) != nullptr)
+      kept.push_back(i);
+  }
+
+  config << std::setprecision(std::numeric_limits<T>::max_digits10)
+         << learning_rate << " " << kept.size();
+  for (size_t i : kept) {
+    config << " " << i;
+    writer.add(currentMaster(*layers[i])->weights);
+  }
+}
+
+/*
+ * @brief Restore the learning rate and the master copies of 16-bit
+ * weights
+ */
+template <typename T>
+void SGD<T>::loadState(const vector<std::unique_ptr<Layer<T>>> &layers,
+                       std::istream &config, checkpoint::Reader &reader) {
+  size_t count = 0;
+  if (!(config >> learning_rate >> count)) {
+    throw std::runtime_error("Corrupt SGD state");
+  }
+
+  master_weights.clear();
+  for (size_t n = 0; n < count; n++) {
+    size_t i;
+    if (!(config >> i) || i >= layers.size()) {
+      throw std::runtime_error("Corrupt SGD state");
+    }
+    const checkpoint::Tensor &master = reader.read();
+    if (master.rows != size_t(layers[i]->getOutputSize()) ||
+        master.cols != size_t(layers[i]->getInputSize())) {
+      throw std::runtime_error("Corrupt SGD state");
+    }
+
+    // padded like the weight gradients the steps add, and current for the
+    // weights the layer has just read
+    MasterCopy &copy = master_weights[layers[i].get()];
+    checkpoint::copy(master, copy.weights, true);
+    copy.version = layers[i]->weightVersion();
+  }
+}
+
+template class SGD<float>;
+template class SGD<double>;
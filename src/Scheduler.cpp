@@ -0,0 +1,390 @@
+#include "../include/Scheduler.h"
+#include "../include/Numa.h"
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// Scheduler the calling thread is a worker of, and its index there
+thread_local const Scheduler *current_scheduler = nullptr;
+thread_local size_t current_worker = 0;
+
+// Failed looks for a job before a worker goes to sleep
+const int spin_rounds = 64;
+} // namespace
+
+Scheduler::JobQueue::JobQueue() : jobs(16), head(0), count(0) {}
+
+void Scheduler::JobQueue::pushBack(const Job &job) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (count == jobs.size()) {
+    // unroll the ring into a buffer twice as large
+    std::vector<Job> grown(2 * jobs.size());
+    for (size_t i = 0; i < count; i++) {
+      grown[i] = jobs[(head + i) % jobs.size()];
+    }
+    jobs.swap(grown);
+    head = 0;
+  }
+
+  jobs[(head + count) % jobs.size()] = job;
+  count++;
+}
+
+bool Scheduler::JobQueue::popBack(Job &job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (count == 0)
+    return false;
+
+  count--;
+  job = jobs[(head + count) % jobs.size()];
+  return true;
+}
+
+bool Scheduler::JobQueue::popFront(Job &job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (count == 0)
+    return false;
+
+  job = jobs[head];
+  head = (head + 1) % jobs.size();
+  count--;
+  return true;
+}
+
+/*
+ * @brief Start the workers
+ * @param size number of threads including the caller
+ * @param pin pin each worker to one of the CPUs the caller may run on
+ */
+Scheduler::Scheduler(size_t size, bool pin)
+    : queued(0), sleeping(0), stopping(false) {
+  if (size < 1) {
+    throw std::invalid_argument("Thread count must be positive");
+  }
+
+  // Workers steal from every deque, so all exist before the first starts
+  for (size_t worker = 0; worker + 1 < size; worker++) {
+    queues.push_back(std::make_unique<JobQueue>());
+  }
+
+  // Worker w gets the (w + 1)-th CPU the caller may use, the first being
+  // the caller's; taken from its affinity, so taskset and cpusets hold
+  std::vector<int> cpus;
+  if (pin)
+    cpus = numa::allowedCpus();
+
+  try {
+    for (size_t worker = 0; worker + 1 < size; worker++) {
+      threads.emplace_back(&Scheduler::run, this, worker);
+#ifdef __linux__
+      if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[(worker + 1) % cpus.size()], &set);
+        int error = pthread_setaffinity_np(threads.back().native_handle(),
+                                           sizeof(set), &set);
+        if (error != 0) {
+          throw std::system_error(error, std::generic_category(),
+                                  "Cannot pin scheduler worker");
+        }
+      }
+#endif
+    }
+  } catch (...) {
+    stop();
+    throw;
+  }
+}
+
+Scheduler::~Scheduler() { stop(); }
+
+/*
+ * @brief Wake the workers to stop and join them
+ */
+void Scheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+/*
+ * @brief Index of the calling thread among the workers, or the number of
+ * workers if it is not one
+ */
+size_t Scheduler::self() const {
+  return current_scheduler == this ? current_worker : queues.size();
+}
+
+/*
+ * @brief Queue a job and wake a sleeping worker
+ */
+void Scheduler::push(const Job &job) {
+  // counted first, so a worker never sees a queued job it cannot account
+  // for
+  queued.fetch_add(1);
+
+  size_t worker = self();
+  if (worker < queues.size()) {
+    queues[worker]->pushBack(job);
+  } else {
+    shared.pushBack(job);
+  }
+
+  if (sleeping.load() > 0) {
+    // a worker between checking for jobs and waiting holds the mutex
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    wake.notify_one();
+  }
+}
+
+/*
+ * @brief Take a job: the caller's own newest first, then the oldest of the
+ * shared queue and of the other workers
+ */
+bool Scheduler::take(size_t worker, Job &job) {
+  bool found = worker < queues.size() && queues[worker]->popBack(job);
+
+  if (!found) {
+    found = shared.popFront(job);
+  }
+  for (size_t i = 1; !found && i <= queues.size(); i++) {
+    size_t victim = (worker + i) % queues.size();
+    if (victim != worker) {
+      found = queues[victim]->popFront(job);
+    }
+  }
+
+  if (found) {
+    queued.fetch_sub(1);
+  }
+  return found;
+}
+
+/*
+ * @brief Split a job down to its grain, queueing the upper halves, then
+ * run it and mark it done in its group
+ */
+void Scheduler::execute(Job job) {
+  while (job.end - job.begin > job.grain) {
+    Job upper = job;
+    upper.begin = job.begin + (job.end - job.begin) / 2;
+    job.end = upper.begin;
+    job.group->spawn(upper);
+  }
+
+  try {
+    job.invoke(job.body, job.begin, job.end);
+  } catch (...) {
+    job.group->fail();
+  }
+
+  // the waiting thread may destroy the group as soon as this is 0
+  job.group->pending.fetch_sub(1);
+}
+
+/*
+ * @brief Run jobs until the group has none left
+ */
+void Scheduler::join(TaskGroup &group) {
+  size_t worker = self();
+
+  while (group.pending.load() > 0) {
+    Job job;
+    if (take(worker, job)) {
+      execute(job);
+    } else {
+      // the group's last jobs are running on other threads
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*
+ * @brief Run jobs, sleeping while there are none, until stopped
+ */
+void Scheduler::run(size_t worker) {
+  current_scheduler = this;
+  current_worker = worker;
+
+  int idle = 0;
+  while (true) {
+    Job job;
+    if (take(worker, job)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+
+    // Spin a little: splits of a running loop come in bursts
+    if (++idle < spin_rounds) {
+      std::this_thread::yield();
+      continue;
+    }
+    idle = 0;
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleeping.fetch_add(1);
+    wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+    sleeping.fetch_sub(1);
+    if (stopping)
+      return;
+  }
+}
+
+/*
+ * @brief Run body(b, e) over ranges covering [begin, end) and wait
+ */
+void Scheduler::parallelFor(size_t begin, size_t end, size_t grain,
+                            const Task &body) {
+  if (begin >= end)
+    return;
+
+  // The caller splits the loop itself and keeps the lowest range
+  TaskGroup group(*this);
+  group.pending.fetch_add(1);
+  execute({body.body, body.invoke, begin, end, std::max<size_t>(grain, 1),
+           &group});
+  group.wait();
+}
+
+TaskGroup::TaskGroup(Scheduler &scheduler)
+    : scheduler(scheduler), pending(0) {}
+
+TaskGroup::~TaskGroup() {
+  if (pending.load() > 0)
+    scheduler.join(*this);
+}
+
+void TaskGroup::spawn(const Scheduler::Job &job) {
+  pending.fetch_add(1);
+  scheduler.push(job);
+}
+
+void TaskGroup::fail() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!error)
+    error = std::current_exception();
+}
+
+/*
+ * @brief Run body(begin, end) over ranges of [begin, end) without waiting
+ */
+void TaskGroup::run(size_t begin, size_t end, size_t grain,
+                    const Scheduler::Task &body) {
+  if (begin < end) {
+    spawn({body.body, body.invoke, begin, end, std::max<size_t>(grain, 1),
+           this});
+  }
+}
+
+/*
+ * @brief Wait for every task of the group, then rethrow the first
+ * exception of a task
+ */
+void TaskGroup::wait() {
+  scheduler.join(*this);
+
+  if (error) {
+    std::exception_ptr thrown = error;
+    error = nullptr;
+    std::rethrow_exception(thrown);
+  }
+}
+
+namespace parallel {
+
+namespace {
+std::atomic<size_t> thread_count(0);
+std::atomic<bool> pinning(false);
+std::atomic<size_t> min_work(size_t(1) << 20);
+std::mutex scheduler_mutex; // guards starting and replacing the scheduler
+std::unique_ptr<Scheduler> shared_scheduler;
+std::atomic<Scheduler *> started(nullptr);
+
+/*
+ * @brief Stop the shared scheduler, so the next call starts a new one
+ */
+void restart() {
+  started.store(nullptr);
+  shared_scheduler.reset();
+}
+} // namespace
+
+void setThreads(size_t threads) {
+  std::lock_guard<std::mutex> lock(scheduler_mutex);
+  thread_count.store(threads, std::memory_order_relaxed);
+  restart();
+}
+
+size_t threads() {
+  size_t count = thread_count.load(std::memory_order_relaxed);
+  if (count == 0) {
+    // one per CPU the process may use, not per CPU of the machine
+    count = numa::allowedCpus().size();
+    if (count == 0)
+      count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return count;
+}
+
+void setPinning(bool enabled) {
+  std::lock_guard<std::mutex> lock(scheduler_mutex);
+  pinning.store(enabled, std::memory_order_relaxed);
+  restart();
+}
+
+void setMinWork(size_t multiply_adds) {
+  min_work.store(multiply_adds, std::memory_order_relaxed);
+}
+
+size_t minWork() { return min_work.load(std::memory_order_relaxed); }
+
+Scheduler &scheduler() {
+  Scheduler *running = started.load(std::memory_order_acquire);
+  if (running != nullptr)
+    return *running;
+
+  std::lock_guard<std::mutex> lock(scheduler_mutex);
+  if (!shared_scheduler) {
+    shared_scheduler = std::make_unique<Scheduler>(
+        threads(), pinning.load(std::memory_order_relaxed));
+    started.store(shared_scheduler.get(), std::memory_order_release);
+  }
+  return *shared_scheduler;
+}
+
+/*
+ * @brief Split [0, n) into ranges and run body on each on the shared
+ * scheduler
+ */
+void forRange(size_t n, size_t work, const Scheduler::Task &body,
+              size_t align) {
+  size_t count = threads();
+  size_t blocks = (n + align - 1) / align;
+
+  if (count < 2 || blocks < 2 || work < minWork()) {
+    body(0, n);
+    return;
+  }
+
+  // About two ranges per thread, so idle threads can steal from busy ones
+  size_t grain = std::max<size_t>(1, blocks / (2 * count));
+  scheduler().parallelFor(0, blocks, grain, [&](size_t first, size_t last) {
+    body(first * align, std::min(n, last * align));
+  });
+}
+
+} // namespace parallel
@@ -1,73 +1,1185 @@
 #include "../include/SequentialModel.h"
+#include "../include/Numa.h"
+#include "../include/Registry.h"
+#include "../include/kernels/Gemm.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
 using std::vector;
 
-SequentialModel::SequentialModel(vector<std::unique_ptr<Layer>> layers_vec,
-                                 std::unique_ptr<Loss> loss_function,
-                                 std::unique_ptr<Optimizer> optimizer,
-                                 int total_epochs)
+namespace {
+
+// First line of the architecture of a model archive
+const char *archive_magic = "easylearn-model";
+const int archive_version = 1;
+
+const char *precisionName(WeightPrecision precision) {
+  switch (precision) {
+  case WeightPrecision::BFloat16:
+    return "BFloat16";
+  case WeightPrecision::Float16:
+    return "Float16";
+  default:
+    return "Full";
+  }
+}
+
+WeightPrecision parsePrecision(const std::string &name) {
+  if (name == "BFloat16")
+    return WeightPrecision::BFloat16;
+  if (name == "Float16")
+    return WeightPrecision::Float16;
+  if (name == "Full")
+    return WeightPrecision::Full;
+  throw std::runtime_error("Unknown weight precision " + name);
+}
+
+/*
+ * @brief Read "key value" from an archive's architecture
+ */
+template <typename V>
+V readField(std::istream &config, const char *key, const std::string &path) {
+  std::string found;
+  V value;
+  if (!(config >> found) || found != key || !(config >> value)) {
+    throw std::runtime_error(std::string("Corrupt model archive (") + key +
+                             "): " + path);
+  }
+  return value;
+}
+
+/*
+ * @brief Copy samples [begin, end) into a batch matrix, one sample per row
+ * @param batch destination of end - begin rows
+ */
+template <typename T>
+void fillBatch(const vector<vector<T>> &samples, size_t begin, size_t end,
+               Matrix<T> &batch) {
+  for (size_t n = begin; n < end; n++) {
+    std::copy(samples[n].begin(), samples[n].end(), batch.row(n - begin));
+  }
+}
+
+/*
+ * @brief Copy samples [begin, end) into a new batch matrix
+ */
+template <typename T>
+Matrix<T> makeBatch(const vector<vector<T>> &samples, size_t begin,
+                    size_t end) {
+  Matrix<T> batch(end - begin, samples[begin].size());
+  fillBatch(samples, begin, end, batch);
+  return batch;
+}
+
+/*
+ * @brief Copy samples [begin, end) into a batch allocated from an arena
+ * @return view valid until the next reset of the arena
+ */
+template <typename T>
+Matrix<T> arenaBatch(Arena &arena, const vector<vector<T>> &samples,
+                     size_t begin, size_t end) {
+  size_t rows = end - begin;
+  size_t cols = samples[begin].size();
+
+  Matrix<T> batch =
+      Matrix<T>::view(arena.allocate<T>(rows * cols), rows, cols, cols);
+  fillBatch(samples, begin, end, batch);
+  return batch;
+}
+
+/*
+ * @brief Multiply every value of a matrix, padding excluded
+ */
+template <typename T> void scaleRows(Matrix<T> &matrix, T scale) {
+  for (size_t n = 0; n < matrix.rows(); n++) {
+    T *row = matrix.row(n);
+    for (size_t i = 0; i < matrix.cols(); i++) {
+      row[i] *= scale;
+    }
+  }
+}
+
+/*
+ * @brief Split layers into contiguous groups of about equal cost
+ * @param costs cost of every layer
+ * @param groups number of groups, between 1 and costs.size()
+ * @return first layer of every group, followed by costs.size()
+ */
+vector<size_t> partitionLayers(const vector<size_t> &costs, size_t groups) {
+  double total = 0.0;
+  for (size_t cost : costs) {
+    total += cost;
+  }
+
+  vector<size_t> bounds(1, 0);
+  double prefix = 0.0;
+  size_t layer = 0;
+  for (size_t g = 1; g < groups; g++) {
+    // At least one layer per group, and one left for each later group;
+    // a layer joins the group if most of it falls before the split point
+    prefix += costs[layer++];
+    while (layer < costs.size() - (groups - g) &&
+           prefix + costs[layer] / 2.0 <= total * g / groups) {
+      prefix += costs[layer++];
+    }
+    bounds.push_back(layer);
+  }
+  bounds.push_back(costs.size());
+  return bounds;
+}
+
+/*
+ * @brief Bounded FIFO of micro-batch numbers between two pipeline stages
+ *
+ * push blocks while the queue is full and pop while it is empty. Once
+ * closed (a stage failed), both return false instead of blocking.
+ */
+class Channel {
+private:
+  std::mutex mutex;
+  std::condition_variable changed;
+  vector<size_t> items; // ring buffer
+  size_t head;          // index of the oldest item
+  size_t count;         // number of queued items
+  bool closed;
+
+public:
+  explicit Channel(size_t capacity)
+      : items(capacity), head(0), count(0), closed(false) {}
+
+  bool push(size_t item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return closed || count < items.size(); });
+    if (closed)
+      return false;
+
+    items[(head + count) % items.size()] = item;
+    count++;
+    changed.notify_all();
+    return true;
+  }
+
+  bool pop(size_t &item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return closed || count > 0; });
+    if (closed)
+      return false;
+
+    item = items[head];
+    head = (head + 1) % items.size();
+    count--;
+    changed.notify_all();
+    return true;
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    changed.notify_all();
+  }
+};
+
+} // namespace
+
+template <typename T>
+SequentialModel<T>::SequentialModel(
+    vector<std::unique_ptr<Layer<T>>> layers_vec,
+    std::unique_ptr<Loss<T>> loss_function,
+    std::unique_ptr<Optimizer<T>> optimizer, int total_epochs)
 
     : layers(std::move(layers_vec)), loss_func(std::move(loss_function)),
-      optimizer(std::move(optimizer)), epochs(total_epochs) {}
+      optimizer(std::move(optimizer)), epochs(total_epochs),
+      fused_update(false), training(true) {
+  // Transient tensors of every step live in the arena
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->setArena(&arena);
+  }
+  loss_func->setArena(&arena);
+
+  planWorkspace();
+}
+
+/*
+ * @brief Size the workspace for the widest layer output
+ */
+template <typename T> void SequentialModel<T>::planWorkspace() {
+  // Widest intermediate activation, for the ping-pong rows of predictInto
+  int width = 0;
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    width = std::max(width, layer->getOutputSize());
+  }
+  workspace.resize(2, width, T(), true);
+}
+
+template <typename T>
+void SequentialModel<T>::reportProgress(int epoch, double loss,
+                                        size_t samples) const {
+  // Fewer than ten epochs would make the interval zero
+  if (epoch % std::max(1, epochs / 10) == 0)
+    std::cout << "Average loss after " << epoch
+              << " epochs = " << loss / samples << std::endl;
+}
 
 /*
  * @brief Get the model's output (prediction)
  * @param input input data (features)
  * @return output value
  */
-vector<double> SequentialModel::predict(const vector<double> &input) {
-  vector<double> activation = input;
+template <typename T>
+vector<T> SequentialModel<T>::predict(const vector<T> &input) {
+  arena.reset();
+  vector<T> activation = input;
+
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    activation = layer->forward(activation);
+  }
+  return activation;
+}
+
+/*
+ * @brief Get the model's outputs for a batch of samples
+ * @param inputs input data (features), one sample per row
+ * @return output values, one sample per row
+ */
+template <typename T>
+Matrix<T> SequentialModel<T>::predict(const Matrix<T> &inputs) {
+  arena.reset();
+  return forwardBatch(inputs);
+}
+
+/*
+ * @brief Forward a batch through all layers without copying activations
+ * @return output of the last layer (owned by that layer)
+ */
+template <typename T>
+const Matrix<T> &SequentialModel<T>::forwardBatch(const Matrix<T> &inputs) {
+  const Matrix<T> *activation = &inputs;
+
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    activation = &layer->forward(*activation);
+  }
+  return *activation;
+}
+
+/*
+ * @brief Get the model's output for one sample into a caller buffer
+ * @param input input size of the first layer values
+ * @param output output size of the last layer values
+ */
+template <typename T>
+void SequentialModel<T>::predictInto(const T *input, T *output) {
+  const T *activation = input;
+
+  for (size_t i = 0; i < layers.size(); i++) {
+    T *next = i + 1 == layers.size() ? output : workspace.row(i % 2);
+    layers[i]->forwardInto(activation, next);
+    activation = next;
+  }
+}
+
+/*
+ * @brief Get the number of inputs of the first layer
+ */
+template <typename T> int SequentialModel<T>::getInputSize() const {
+  return layers.front()->getInputSize();
+}
+
+/*
+ * @brief Get the number of outputs of the last layer
+ */
+template <typename T> int SequentialModel<T>::getOutputSize() const {
+  return layers.back()->getOutputSize();
+}
+
+/*
+ * @brief Switch between training (default) and evaluation mode
+ * @param enabled false for inference only
+ */
+template <typename T> void SequentialModel<T>::setTraining(bool enabled) {
+  training = enabled;
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->setTraining(enabled);
+  }
+
+  // the arena was sized for forward and backward together
+  if (!training) {
+    arena.release();
+  }
+}
+
+/*
+ * @brief Get the memory held by the layers and the model's buffers
+ * @return parameter, gradient and activation bytes
+ */
+template <typename T> MemoryUsage SequentialModel<T>::memoryUsage() const {
+  MemoryUsage usage = {};
+  for (const std::unique_ptr<Layer<T>> &layer : layers) {
+    MemoryUsage layer_usage = layer->memoryUsage();
+    usage.parameters += layer_usage.parameters;
+    usage.gradients += layer_usage.gradients;
+    usage.activations += layer_usage.activations;
+  }
+  usage.activations += arena.capacity() + workspace.allocatedBytes();
+  return usage;
+}
+
+/*
+ * @brief Get the model's outputs for a batch without touching its state
+ * @param inputs input data (features), one sample per row
+ * @param scratch caller-owned arena for the activations, reset by the call
+ * @return output values, one sample per row (a view into scratch)
+ */
+template <typename T>
+Matrix<T> SequentialModel<T>::predict(const Matrix<T> &inputs,
+                                      Arena &scratch) const {
+  scratch.reset();
+  size_t batch_size = inputs.rows();
+  Matrix<T> activation = Matrix<T>::view(const_cast<T *>(inputs.data()),
+                                         batch_size, inputs.cols(),
+                                         inputs.stride());
+
+  for (const std::unique_ptr<Layer<T>> &layer : layers) {
+    size_t width = layer->getOutputSize();
+    Matrix<T> output = Matrix<T>::view(
+        scratch.allocate<T>(batch_size * width), batch_size, width, width);
+    layer->forwardInto(activation, output);
+    activation = std::move(output);
+  }
+  return activation;
+}
+
+/*
+ * @brief Get the model's output for one sample without touching its state
+ * @param input input size of the first layer values
+ * @param output output size of the last layer values
+ * @param scratch caller-owned arena for the activations, reset by the call
+ */
+template <typename T>
+void SequentialModel<T>::predictInto(const T *input, T *output,
+                                     Arena &scratch) const {
+  scratch.reset();
+  const T *activation = input;
+
+  for (size_t i = 0; i < layers.size(); i++) {
+    T *next = i + 1 == layers.size()
+                  ? output
+                  : scratch.allocate<T>(layers[i]->getOutputSize());
+    layers[i]->forwardInto(activation, next);
+    activation = next;
+  }
+}
+
+/*
+ * @brief Store the weights of every layer in the given format
+ * @param precision Full, BFloat16 or Float16
+ */
+template <typename T>
+void SequentialModel<T>::setWeightPrecision(WeightPrecision precision) {
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->setWeightPrecision(precision);
+    optimizer->resetState(*layer);
+  }
+}
+
+/*
+ * @brief Apply the optimizer inside each layer's backward pass
+ * @param enabled turn the fused update on or off
+ */
+template <typename T> void SequentialModel<T>::setFusedUpdate(bool enabled) {
+  fused_update = enabled;
+}
+
+/*
+ * @brief Whether the optimizer update of a layer runs inside its backward
+ * @param learning_rate set to the fused step size
+ */
+template <typename T>
+bool SequentialModel<T>::fusedUpdate(const Layer<T> &layer,
+                                     T &learning_rate) const {
+  return fused_update &&
+         layer.getWeightPrecision() == WeightPrecision::Full &&
+         optimizer->fusedLearningRate(learning_rate);
+}
+
+/*
+ * @brief Build an int8 copy of the model for inference
+ * @param calibration_inputs sample inputs used to choose the input scale
+ * of each layer
+ */
+template <typename T>
+void SequentialModel<T>::quantize(
+    const vector<vector<T>> &calibration_inputs) {
+  if (calibration_inputs.empty()) {
+    throw std::invalid_argument("Quantization needs calibration inputs");
+  }
+
+  arena.reset();
+  Matrix<T> activation =
+      makeBatch(calibration_inputs, 0, calibration_inputs.size());
 
-  for (std::unique_ptr<Layer> &layer : layers) {
+  quantized_layers.clear();
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    // Input scale from the largest magnitude reaching this layer
+    T max_input = 0;
+    for (size_t i = 0; i < activation.storageSize(); i++) {
+      max_input = std::max(max_input, std::fabs(activation.data()[i]));
+    }
+
+    quantized_layers.emplace_back(*layer, max_input);
     activation = layer->forward(activation);
   }
+}
+
+/*
+ * @brief Get the quantized model's output
+ * @param input input data (features)
+ * @return output value
+ */
+template <typename T>
+vector<T> SequentialModel<T>::predictQuantized(const vector<T> &input) {
+  Matrix<T> batch(1, input.size());
+  std::copy(input.begin(), input.end(), batch.row(0));
+
+  Matrix<T> output = predictQuantized(batch);
+  return vector<T>(output.row(0), output.row(0) + output.cols());
+}
+
+/*
+ * @brief Get the quantized model's outputs for a batch of samples
+ * @param inputs input data (features), one sample per row
+ * @return output values, one sample per row
+ */
+template <typename T>
+Matrix<T> SequentialModel<T>::predictQuantized(const Matrix<T> &inputs) {
+  if (quantized_layers.empty()) {
+    throw std::runtime_error("Model is not quantized");
+  }
+
+  Matrix<T> activation = inputs;
+
+  for (const QuantizedLayer<T> &layer : quantized_layers) {
+    activation = layer.forward(activation);
+  }
   return activation;
 }
 
+/*
+ * @brief Compare the quantized model with the original one
+ * @param inputs input data (features)
+ * @param targets reference output values
+ * @return losses, output differences and parameter sizes of both models
+ */
+template <typename T>
+QuantizationReport<T>
+SequentialModel<T>::quantizationReport(const vector<vector<T>> &inputs,
+                                       const vector<vector<T>> &targets) {
+  QuantizationReport<T> report = {};
+  Matrix<T> batch_inputs = makeBatch(inputs, 0, inputs.size());
+  Matrix<T> batch_targets = makeBatch(targets, 0, targets.size());
+
+  Matrix<T> output = predict(batch_inputs);
+  Matrix<T> quantized_output = predictQuantized(batch_inputs);
+
+  report.loss = loss_func->evaluate(output, batch_targets);
+  report.quantized_loss = loss_func->evaluate(quantized_output, batch_targets);
+
+  for (size_t n = 0; n < output.rows(); n++) {
+    for (size_t i = 0; i < output.cols(); i++) {
+      T error = std::fabs(output(n, i) - quantized_output(n, i));
+      report.max_abs_error = std::max(report.max_abs_error, error);
+      report.mean_abs_error += error;
+    }
+  }
+  report.mean_abs_error /= output.rows() * output.cols();
+
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    report.bytes += layer->getWeights().storageSize() * sizeof(T) +
+                    layer->getBiases().storageSize() * sizeof(T);
+  }
+  for (const QuantizedLayer<T> &layer : quantized_layers) {
+    report.quantized_bytes += layer.parameterBytes();
+  }
+
+  return report;
+}
+
 /*
  * @brief Perform back propagation
  */
-void SequentialModel::backward() {
-  vector<double> gradient = loss_func->computeGrad();
+template <typename T> void SequentialModel<T>::backward() {
+  if (!training) {
+    throw std::logic_error("Model is in evaluation mode");
+  }
+  vector<T> gradient = loss_func->computeGrad();
+
+  for (int i = layers.size() - 1; i > 0; i--) {
+    T learning_rate;
+    if (fusedUpdate(*layers[i], learning_rate)) {
+      gradient = layers[i]->backwardAndUpdate(gradient, learning_rate);
+    } else {
+      gradient = layers[i]->backward(gradient);
+      optimizer->step(*layers[i]);
+    }
+  }
+}
+
+/*
+ * @brief Perform back propagation for the last predicted batch
+ */
+template <typename T> void SequentialModel<T>::backwardBatch() {
+  // Each gradient is a buffer owned by the loss or a layer
+  const Matrix<T> *gradient = &loss_func->computeBatchGrad();
 
   for (int i = layers.size() - 1; i > 0; i--) {
-    gradient = layers[i]->backward(gradient);
-    optimizer->step(*layers[i]);
+    T learning_rate;
+    if (fusedUpdate(*layers[i], learning_rate)) {
+      gradient = &layers[i]->backwardAndUpdate(*gradient, learning_rate);
+    } else {
+      gradient = &layers[i]->backward(*gradient);
+      optimizer->step(*layers[i]);
+    }
+  }
+}
+
+/*
+ * @brief Train the model
+ * @param inputs input data (features)
+ * @param targets reference output values
+ * @param batch_size number of samples per gradient step
+ */
+template <typename T>
+void SequentialModel<T>::train(const vector<vector<T>> &inputs,
+                               const vector<vector<T>> &targets,
+                               int batch_size) {
+  if (batch_size < 1) {
+    throw std::invalid_argument("Batch size must be positive");
+  }
+  if (!training) {
+    throw std::logic_error("Model is in evaluation mode");
+  }
+
+  for (int epoch = 1; epoch <= epochs; epoch++) {
+
+    double loss = 0.0;
+
+    for (size_t begin = 0; begin < inputs.size(); begin += batch_size) {
+      size_t end = std::min(inputs.size(), begin + batch_size);
+      // Everything allocated by the previous step is released at once
+      arena.reset();
+      Matrix<T> batch_inputs = arenaBatch(arena, inputs, begin, end);
+      Matrix<T> batch_targets = arenaBatch(arena, targets, begin, end);
+
+      const Matrix<T> &output = forwardBatch(batch_inputs);
+      loss += loss_func->computeLoss(output, batch_targets) * (end - begin);
+      backwardBatch();
+    }
+
+    reportProgress(epoch, loss, inputs[0].size());
+  }
+}
+
+/*
+ * @brief Train on samples [begin, end) with shared-parameter updates
+ * @param activations one matrix per layer, for views of its outputs
+ * @param scratch arena of the calling worker
+ * @return loss summed over the samples
+ */
+template <typename T>
+double SequentialModel<T>::trainShard(
+    const vector<vector<T>> &inputs, const vector<vector<T>> &targets,
+    size_t begin, size_t end, int batch_size, T learning_rate,
+    SharedUpdate update, vector<Matrix<T>> &activations, Arena &scratch) {
+  double loss = 0.0;
+
+  for (size_t first = begin; first < end; first += batch_size) {
+    size_t last = std::min(end, first + batch_size);
+    size_t rows = last - first;
+
+    scratch.reset();
+    Matrix<T> batch_inputs = arenaBatch(scratch, inputs, first, last);
+    Matrix<T> batch_targets = arenaBatch(scratch, targets, first, last);
+
+    // The outputs of every layer are kept for its backward
+    const Matrix<T> *activation = &batch_inputs;
+    for (size_t i = 0; i < layers.size(); i++) {
+      size_t width = layers[i]->getOutputSize();
+      activations[i] = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                       rows, width, width);
+      layers[i]->forwardInto(*activation, activations[i]);
+      activation = &activations[i];
+    }
+
+    loss += loss_func->evaluate(*activation, batch_targets) * rows;
+    size_t width = activation->cols();
+    Matrix<T> gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                         rows, width, width);
+    loss_func->gradientInto(*activation, batch_targets, gradient);
+
+    // Same layers as backwardBatch
+    for (size_t i = layers.size() - 1; i > 0; i--) {
+      Matrix<T> input_gradient;
+      if (i > 1) {
+        width = layers[i]->getInputSize();
+        input_gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                         rows, width, width);
+      }
+
+      layers[i]->backwardAndUpdateInto(
+          activations[i - 1], activations[i], gradient,
+          i > 1 ? &input_gradient : nullptr, learning_rate, update, scratch);
+      gradient = std::move(input_gradient);
+    }
+  }
+  return loss;
+}
+
+/*
+ * @brief Train the model with lock-free parallel SGD (Hogwild)
+ * @param inputs input data (features)
+ * @param targets reference output values
+ * @param threads number of workers, each training on its own shard
+ * @param batch_size number of samples per gradient step of a worker
+ * @param update how workers write to the shared parameters
+ */
+template <typename T>
+void SequentialModel<T>::trainHogwild(const vector<vector<T>> &inputs,
+                                      const vector<vector<T>> &targets,
+                                      int threads, int batch_size,
+                                      SharedUpdate update) {
+  if (batch_size < 1) {
+    throw std::invalid_argument("Batch size must be positive");
+  }
+  if (threads < 1) {
+    throw std::invalid_argument("Thread count must be positive");
+  }
+  if (!training) {
+    throw std::logic_error("Model is in evaluation mode");
+  }
+
+  T learning_rate;
+  if (!optimizer->fusedLearningRate(learning_rate)) {
+    throw std::logic_error("Hogwild training needs a plain SGD optimizer");
+  }
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    if (layer->getWeightPrecision() != WeightPrecision::Full) {
+      throw std::logic_error("Hogwild training needs full precision weights");
+    }
+  }
+
+  // Per-worker state, kept across epochs
+  vector<std::unique_ptr<Arena>> arenas;
+  vector<vector<Matrix<T>>> activations(threads);
+  for (int w = 0; w < threads; w++) {
+    arenas.push_back(std::make_unique<Arena>());
+    activations[w].resize(layers.size());
+  }
+
+  vector<double> losses(threads);
+
+  for (int epoch = 1; epoch <= epochs; epoch++) {
+    // One task per worker; the scheduler rethrows the first error
+    parallel::scheduler().parallelFor(
+        0, threads, 1, [&](size_t first, size_t last) {
+          for (size_t w = first; w < last; w++) {
+            size_t begin = inputs.size() * w / threads;
+            size_t end = inputs.size() * (w + 1) / threads;
+            losses[w] = trainShard(inputs, targets, begin, end, batch_size,
+                                   learning_rate, update, activations[w],
+                                   *arenas[w]);
+          }
+        });
+
+    double loss = 0.0;
+    for (int w = 0; w < threads; w++) {
+      loss += losses[w];
+    }
+
+    reportProgress(epoch, loss, inputs[0].size());
+  }
+}
+
+/*
+ * @brief Compute the gradients of samples [begin, end) of a batch
+ * @param model layers to run: layers, or a replica of them
+ * @param batch_rows number of samples of the whole batch
+ * @param grads weight and bias gradients of layer i at 2 * i, 2 * i + 1
+ * @return loss summed over the samples
+ */
+template <typename T>
+double SequentialModel<T>::shardGradients(
+    const vector<std::unique_ptr<Layer<T>>> &model,
+    const vector<vector<T>> &inputs, const vector<vector<T>> &targets,
+    size_t begin, size_t end, size_t batch_rows, vector<Matrix<T>> &grads,
+    vector<Matrix<T>> &activations, Arena &scratch) {
+  size_t rows = end - begin;
+
+  scratch.reset();
+  Matrix<T> batch_inputs = arenaBatch(scratch, inputs, begin, end);
+  Matrix<T> batch_targets = arenaBatch(scratch, targets, begin, end);
+
+  const Matrix<T> *activation = &batch_inputs;
+  for (size_t i = 0; i < model.size(); i++) {
+    size_t width = model[i]->getOutputSize();
+    activations[i] = Matrix<T>::view(scratch.allocate<T>(rows * width), rows,
+                                     width, width);
+    model[i]->forwardInto(*activation, activations[i]);
+    activation = &activations[i];
+  }
+
+  double loss = loss_func->evaluate(*activation, batch_targets) * rows;
+  size_t width = activation->cols();
+  Matrix<T> gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                       rows, width, width);
+  loss_func->gradientInto(*activation, batch_targets, gradient);
+
+  // The loss averages over the shard; average over the whole batch instead
+  scaleRows(gradient, T(rows) / T(batch_rows));
+
+  // Same layers as backwardBatch
+  for (size_t i = model.size() - 1; i > 0; i--) {
+    Matrix<T> input_gradient;
+    if (i > 1) {
+      width = model[i]->getInputSize();
+      input_gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                       rows, width, width);
+    }
+
+    model[i]->backwardInto(activations[i - 1], activations[i], gradient,
+                            i > 1 ? &input_gradient : nullptr, grads[2 * i],
+                            grads[2 * i + 1], scratch);
+    gradient = std::move(input_gradient);
+  }
+  return loss;
+}
+
+/*
+ * @brief Train the model with synchronous data parallelism
+ * @param inputs input data (features)
+ * @param targets reference output values
+ * @param threads most shards computed at a time
+ * @param batch_size number of samples per optimizer step
+ * @param shard_size number of samples per gradient shard
+ * @param numa_aware pin threads per NUMA node and replicate the parameters
+ */
+template <typename T>
+void SequentialModel<T>::trainDataParallel(const vector<vector<T>> &inputs,
+                                           const vector<vector<T>> &targets,
+                                           int threads, int batch_size,
+                                           int shard_size, bool numa_aware) {
+  if (batch_size < 1 || shard_size < 1) {
+    throw std::invalid_argument("Batch size must be positive");
+  }
+  if (threads < 1) {
+    throw std::invalid_argument("Thread count must be positive");
+  }
+  if (!training) {
+    throw std::logic_error("Model is in evaluation mode");
+  }
+
+  Scheduler &scheduler = parallel::scheduler();
+  size_t max_shards = (batch_size + shard_size - 1) / shard_size;
+  size_t slots = std::min<size_t>(threads, max_shards);
+
+  // Slot w runs shards w, w + slots, ... one after the other, with its own
+  // scratch. With numa_aware each slot is a thread pinned to a node, which
+  // touches the buffers of its shards first and reads its node's replica
+  // of the parameters (the node holding the model reads the model). The
+  // caller is worker 0 of the pool: its affinity is restored on return,
+  // after the pool has stopped, or when training throws.
+  std::unique_ptr<numa::AffinityGuard> affinity;
+  std::unique_ptr<ThreadPool> pinned;
+  vector<size_t> slot_nodes(slots, 0);
+  size_t home = 0;
+  if (numa_aware) {
+    affinity = std::make_unique<numa::AffinityGuard>();
+    pinned = std::make_unique<ThreadPool>(slots);
+    for (size_t w = 0; w < slots; w++) {
+      slot_nodes[w] = w * numa::nodes() / slots;
+    }
+    home = std::max(0, numa::nodeOf(layers[0]->parameter(1).values));
+  }
+  vector<vector<std::unique_ptr<Layer<T>>>> replicas(numa::nodes());
+
+  vector<vector<Matrix<T>>> grads(max_shards);
+  vector<double> losses(max_shards);
+  vector<std::unique_ptr<Arena>> arenas;
+  vector<vector<Matrix<T>>> activations(slots);
+  for (size_t w = 0; w < slots; w++) {
+    arenas.push_back(std::make_unique<Arena>());
+    activations[w].resize(layers.size());
+  }
+
+  // A slot leads its node if it is the first slot there
+  auto leads = [&](size_t w) {
+    return w == 0 || slot_nodes[w] != slot_nodes[w - 1];
+  };
+  auto model = [&](size_t w) -> const vector<std::unique_ptr<Layer<T>>> & {
+    return replicas[slot_nodes[w]].empty() ? layers : replicas[slot_nodes[w]];
+  };
+
+  // Runs slot(w) for every slot, on the pinned threads or the scheduler
+  auto forEachSlot = [&](const Scheduler::Task &slot) {
+    if (pinned) {
+      pinned->runOnEach(slot);
+    } else {
+      scheduler.parallelFor(0, slots, 1, [&](size_t first, size_t last) {
+        for (size_t w = first; w < last; w++) {
+          slot(w, w);
+        }
+      });
+    }
+  };
+
+  // Private gradients of every shard, in the layout of the layer's own,
+  // allocated by the slot that fills them
+  auto setup = [&](size_t w, size_t) {
+    if (pinned) {
+      numa::pinThread(slot_nodes[w]);
+      if (leads(w) && slot_nodes[w] != home) {
+        for (std::unique_ptr<Layer<T>> &layer : layers) {
+          replicas[slot_nodes[w]].push_back(layer->replicate());
+        }
+      }
+    }
+
+    for (size_t s = w; s < max_shards; s += slots) {
+      grads[s].resize(2 * layers.size());
+      for (size_t i = 1; i < layers.size(); i++) {
+        grads[s][2 * i] = Matrix<T>(layers[i]->getOutputSize(),
+                                    layers[i]->getInputSize(), T(), true);
+        grads[s][2 * i + 1] = Matrix<T>(1, layers[i]->getOutputSize());
+      }
+    }
+  };
+  forEachSlot(setup);
+
+  for (int epoch = 1; epoch <= epochs; epoch++) {
+
+    double loss = 0.0;
+
+    for (size_t begin = 0; begin < inputs.size(); begin += batch_size) {
+      size_t end = std::min(inputs.size(), begin + batch_size);
+      size_t shards = (end - begin + shard_size - 1) / shard_size;
+
+      auto compute = [&](size_t w, size_t) {
+        for (size_t s = w; s < shards; s += slots) {
+          size_t rows_begin = begin + s * shard_size;
+          size_t rows_end = std::min(end, rows_begin + shard_size);
+          losses[s] = shardGradients(model(w), inputs, targets, rows_begin,
+                                     rows_end, end - begin, grads[s],
+                                     activations[w], *arenas[w]);
+        }
+      };
+      forEachSlot(compute);
+
+      // Pairwise tree: at each level shard i takes in shard i + step, on
+      // the slot that owns shard i
+      for (size_t step = 1; step < shards; step *= 2) {
+        auto reduce = [&](size_t w, size_t) {
+          for (size_t target = 2 * step * w; target + step < shards;
+               target += 2 * step * slots) {
+            for (size_t g = 2; g < grads[target].size(); g++) {
+              Matrix<T> &sum = grads[target][g];
+              kernels::axpy(sum.storageSize(), T(1),
+                            grads[target + step][g].data(), sum.data());
+            }
+          }
+        };
+        forEachSlot(reduce);
+      }
+
+      for (size_t s = 0; s < shards; s++) {
+        loss += losses[s];
+      }
+
+      // One optimizer step with the summed gradients
+      for (size_t i = layers.size() - 1; i > 0; i--) {
+        layers[i]->getWeightGrads() = grads[0][2 * i];
+        layers[i]->getBiasGrads() = grads[0][2 * i + 1];
+        optimizer->step(*layers[i]);
+      }
+
+      // Replicas read the updated parameters, one copy per node
+      if (pinned) {
+        auto refresh = [&](size_t w, size_t) {
+          vector<std::unique_ptr<Layer<T>>> &replica = replicas[slot_nodes[w]];
+          if (leads(w) && !replica.empty()) {
+            for (size_t i = 0; i < layers.size(); i++) {
+              replica[i]->copyParameters(*layers[i]);
+            }
+          }
+        };
+        pinned->runOnEach(refresh);
+      }
+    }
+
+    reportProgress(epoch, loss, inputs[0].size());
+  }
+}
+
+/*
+ * @brief Forward a batch through layers [first, last)
+ * @param input input of layer first
+ * @param activations set to the outputs of the layers, at their index
+ */
+template <typename T>
+void SequentialModel<T>::forwardLayers(size_t first, size_t last,
+                                       const Matrix<T> &input,
+                                       vector<Matrix<T>> &activations,
+                                       Arena &scratch) const {
+  size_t rows = input.rows();
+
+  const Matrix<T> *activation = &input;
+  for (size_t i = first; i < last; i++) {
+    size_t width = layers[i]->getOutputSize();
+    activations[i] = Matrix<T>::view(scratch.allocate<T>(rows * width), rows,
+                                     width, width);
+    layers[i]->forwardInto(*activation, activations[i]);
+    activation = &activations[i];
+  }
+}
+
+/*
+ * @brief Compute the gradients of layers [first, last) for a batch
+ * @param gradient gradient with respect to the outputs of layer last - 1
+ * @param grads weight and bias gradients of layer i at 2 * i, 2 * i + 1
+ * @param accumulate add to grads instead of overwriting them
+ * @return gradient with respect to the inputs of layer first, if needed
+ */
+template <typename T>
+Matrix<T> SequentialModel<T>::backwardLayers(
+    size_t first, size_t last, Matrix<T> gradient,
+    const vector<Matrix<T>> &activations, vector<Matrix<T>> &grads,
+    bool accumulate, Arena &scratch) const {
+  size_t rows = gradient.rows();
+
+  // Same layers as backwardBatch
+  for (size_t i = last - 1; i >= std::max<size_t>(first, 1); i--) {
+    Matrix<T> input_gradient;
+    if (i > 1) {
+      size_t width = layers[i]->getInputSize();
+      input_gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                       rows, width, width);
+    }
+
+    Matrix<T> &weight_grads = grads[2 * i];
+    Matrix<T> &bias_grads = grads[2 * i + 1];
+    Matrix<T> *input_grads = i > 1 ? &input_gradient : nullptr;
+    if (!accumulate) {
+      layers[i]->backwardInto(activations[i - 1], activations[i], gradient,
+                              input_grads, weight_grads, bias_grads, scratch);
+    } else {
+      Matrix<T> dw = Matrix<T>::view(
+          scratch.allocate<T>(weight_grads.storageSize()), weight_grads.rows(),
+          weight_grads.cols(), weight_grads.stride());
+      Matrix<T> db = Matrix<T>::view(scratch.allocate<T>(bias_grads.cols()), 1,
+                                     bias_grads.cols(), bias_grads.cols());
+      layers[i]->backwardInto(activations[i - 1], activations[i], gradient,
+                              input_grads, dw, db, scratch);
+
+      // row by row, as the padding of dw is never written
+      for (size_t n = 0; n < dw.rows(); n++) {
+        kernels::axpy(dw.cols(), T(1), dw.row(n), weight_grads.row(n));
+      }
+      kernels::axpy(db.cols(), T(1), db.data(), bias_grads.data());
+    }
+    gradient = std::move(input_gradient);
   }
+  return gradient;
 }
 
 /*
- * @brief Perform one epoch of training
+ * @brief Train the model with pipeline parallelism across layers
  * @param inputs input data (features)
  * @param targets reference output values
+ * @param stages number of threads, each running a group of layers
+ * @param batch_size number of samples per optimizer step
+ * @param micro_batch_size number of samples streamed at a time
+ * @param queue_capacity micro-batches a stage may run ahead of the next
  */
-void SequentialModel::train(const vector<vector<double>> &inputs,
-                            const vector<vector<double>> &targets) {
+template <typename T>
+void SequentialModel<T>::trainPipeline(const vector<vector<T>> &inputs,
+                                       const vector<vector<T>> &targets,
+                                       int stages, int batch_size,
+                                       int micro_batch_size,
+                                       int queue_capacity) {
+  if (batch_size < 1 || micro_batch_size < 1) {
+    throw std::invalid_argument("Batch size must be positive");
+  }
+  if (stages < 1 || static_cast<size_t>(stages) > layers.size()) {
+    throw std::invalid_argument("Stage count must be between 1 and the "
+                                "number of layers");
+  }
+  if (queue_capacity < 1) {
+    throw std::invalid_argument("Queue capacity must be positive");
+  }
+  if (!training) {
+    throw std::logic_error("Model is in evaluation mode");
+  }
+
+  // Stages of about equal work, which is proportional to the weights
+  vector<size_t> costs;
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    costs.push_back(static_cast<size_t>(layer->getInputSize()) *
+                    layer->getOutputSize());
+  }
+  vector<size_t> bounds = partitionLayers(costs, stages);
+
+  // Gradients accumulated over the micro-batches, in the layout of the
+  // layer's own
+  vector<Matrix<T>> grads(2 * layers.size());
+  for (size_t i = 1; i < layers.size(); i++) {
+    grads[2 * i] = Matrix<T>(layers[i]->getOutputSize(),
+                             layers[i]->getInputSize(), T(), true);
+    grads[2 * i + 1] = Matrix<T>(1, layers[i]->getOutputSize());
+  }
+
+  // Outputs of every layer and gradients at the stage boundaries, per
+  // micro-batch; each stage writes the entries of its own layers
+  size_t micro_batches = (batch_size + micro_batch_size - 1) / micro_batch_size;
+  vector<vector<Matrix<T>>> activations(micro_batches);
+  for (vector<Matrix<T>> &micro_batch : activations) {
+    micro_batch.resize(layers.size());
+  }
+  vector<Matrix<T>> boundary_grads(micro_batches);
+
+  vector<std::unique_ptr<Arena>> arenas;
+  for (int s = 0; s < stages; s++) {
+    arenas.push_back(std::make_unique<Arena>());
+  }
+  vector<double> losses(micro_batches);
+
+  // forward[s] and backward[s] link stages s and s + 1
+  vector<std::unique_ptr<Channel>> forward, backward;
+  for (int s = 0; s + 1 < stages; s++) {
+    forward.push_back(std::make_unique<Channel>(queue_capacity));
+    backward.push_back(std::make_unique<Channel>(queue_capacity));
+  }
+  ThreadPool pool(stages);
+
   for (int epoch = 1; epoch <= epochs; epoch++) {
 
     double loss = 0.0;
 
-    for (int i = 0; i < inputs.size(); i++) {
-      vector<double> output = predict(inputs[i]);
-      loss += loss_func->computeLoss(output, targets[i]);
-      backward();
+    for (size_t begin = 0; begin < inputs.size(); begin += batch_size) {
+      size_t end = std::min(inputs.size(), begin + batch_size);
+      size_t count = (end - begin + micro_batch_size - 1) / micro_batch_size;
+
+      // Every stage blocks on its neighbours, so each needs its own thread
+      pool.parallelFor(stages, [&](size_t s, size_t) {
+        size_t first = bounds[s];
+        size_t last = bounds[s + 1];
+        bool is_first = s == 0;
+        bool is_last = s + 1 == static_cast<size_t>(stages);
+        Arena &scratch = *arenas[s];
+        scratch.reset();
+
+        try {
+          // Forward wavefront
+          for (size_t k = 0; k < count; k++) {
+            size_t m = k;
+            size_t rows_begin = begin + m * micro_batch_size;
+            size_t rows_end = std::min(end, rows_begin + micro_batch_size);
+
+            if (is_first) {
+              Matrix<T> batch_inputs =
+                  arenaBatch(scratch, inputs, rows_begin, rows_end);
+              forwardLayers(first, last, batch_inputs, activations[m],
+                            scratch);
+            } else {
+              if (!forward[s - 1]->pop(m))
+                return;
+              forwardLayers(first, last, activations[m][first - 1],
+                            activations[m], scratch);
+            }
+
+            if (!is_last && !forward[s]->push(m))
+              return;
+          }
+
+          // Backward wavefront, last micro-batch first
+          for (size_t k = count; k-- > 0;) {
+            size_t m = k;
+            Matrix<T> gradient;
+
+            if (is_last) {
+              size_t rows_begin = begin + m * micro_batch_size;
+              size_t rows_end = std::min(end, rows_begin + micro_batch_size);
+              size_t rows = rows_end - rows_begin;
+              Matrix<T> batch_targets =
+                  arenaBatch(scratch, targets, rows_begin, rows_end);
+              const Matrix<T> &output = activations[m][last - 1];
+
+              losses[m] = loss_func->evaluate(output, batch_targets) * rows;
+              size_t width = output.cols();
+              gradient = Matrix<T>::view(scratch.allocate<T>(rows * width),
+                                         rows, width, width);
+              loss_func->gradientInto(output, batch_targets, gradient);
+
+              // The loss averages over the micro-batch; average over the
+              // whole batch instead
+              scaleRows(gradient, T(rows) / T(end - begin));
+            } else {
+              if (!backward[s]->pop(m))
+                return;
+              gradient = std::move(boundary_grads[m]);
+            }
+
+            Matrix<T> input_gradient =
+                backwardLayers(first, last, std::move(gradient),
+                               activations[m], grads, k + 1 < count, scratch);
+
+            if (!is_first) {
+              boundary_grads[m] = std::move(input_gradient);
+              if (!backward[s - 1]->push(m))
+                return;
+            }
+          }
+        } catch (...) {
+          // Unblock the other stages before the pool rethrows
+          for (size_t c = 0; c < forward.size(); c++) {
+            forward[c]->close();
+            backward[c]->close();
+          }
+          throw;
+        }
+      });
+
+      for (size_t m = 0; m < count; m++) {
+        loss += losses[m];
+      }
+
+      // One optimizer step with the accumulated gradients
+      for (size_t i = layers.size() - 1; i > 0; i--) {
+        layers[i]->getWeightGrads() = grads[2 * i];
+        layers[i]->getBiasGrads() = grads[2 * i + 1];
+        optimizer->step(*layers[i]);
+      }
     }
 
-    if (epoch % (epochs / 10) == 0)
-      std::cout << "Average loss after " << epoch
-                << " epochs = " << loss / inputs[0].size() << std::endl;
+    reportProgress(epoch, loss, inputs[0].size());
   }
 }
 
 /*
  * @brief Save weights of each layer
  */
-void SequentialModel::saveParams() {
-  for (std::unique_ptr<Layer> &layer : layers) {
+template <typename T> void SequentialModel<T>::saveParams() {
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
     layer->saveParams();
   }
 }
@@ -75,8 +1187,165 @@ void SequentialModel::saveParams() {
 /*
  * @brief Initialize each layers weights in model with downloaded parameters
  */
-void SequentialModel::downloadParams() {
-  for (std::unique_ptr<Layer> &layer : layers) {
-    layer->downloadParams();
+template <typename T> void SequentialModel<T>::downloadParams() {
+  // Files may change the shapes of the layers, those loaded before a
+  // failing one included
+  try {
+    for (std::unique_ptr<Layer<T>> &layer : layers) {
+      layer->downloadParams();
+      optimizer->resetState(*layer);
+    }
+  } catch (...) {
+    planWorkspace();
+    throw;
   }
+  planWorkspace();
 };
+
+/*
+ * @brief Save the parameters of every layer to one binary checkpoint
+ */
+template <typename T>
+void SequentialModel<T>::saveCheckpoint(const std::string &path) const {
+  checkpoint::Writer writer;
+  for (const std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->writeParams(writer);
+  }
+  writer.write(path);
+}
+
+/*
+ * @brief Load a checkpoint written by saveCheckpoint into the layers
+ */
+template <typename T>
+void SequentialModel<T>::loadCheckpoint(const std::string &path, bool map,
+                                        bool verify) {
+  checkpoint::Reader reader(path, map, verify);
+
+  // Every layer checks its tensors on a copy of the reader first, so the
+  // checkpoint of another architecture leaves the model unchanged
+  checkpoint::Reader probe = reader;
+  for (const std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->checkParams(probe);
+  }
+  if (probe.remaining() != 0) {
+    throw std::runtime_error("Checkpoint has more tensors than the model");
+  }
+
+  for (std::unique_ptr<Layer<T>> &layer : layers) {
+    layer->readParams(reader);
+    optimizer->resetState(*layer);
+  }
+  planWorkspace();
+}
+
+/*
+ * @brief Save the whole model to one archive
+ *
+ * The architecture is the checkpoint's metadata, one field per line:
+ *
+ *   easylearn-model 1
+ *   scalar float32
+ *   epochs 1000
+ *   fused_update 0
+ *   loss MSE
+ *   layers 2
+ *   ReLULayer 2 8 Full        (type, inputs, outputs, weight precision)
+ *   SigmoidLayer 8 1 BFloat16
+ *   optimizer SGD ...         (type, then its saveState line)
+ *
+ * The tensors are those of each layer in order, then the optimizer's.
+ */
+template <typename T>
+void SequentialModel<T>::save(const std::string &path) const {
+  std::ostringstream config;
+  checkpoint::Writer writer;
+
+  config << archive_magic << " " << archive_version << "\n";
+  config << "scalar " << dtypeName<T>() << "\n";
+  config << "epochs " << epochs << "\n";
+  config << "fused_update " << fused_update << "\n";
+  config << "loss " << loss_func->typeName() << "\n";
+  config << "layers " << layers.size() << "\n";
+  for (const std::unique_ptr<Layer<T>> &layer : layers) {
+    config << layer->typeName() << " " << layer->getInputSize() << " "
+           << layer->getOutputSize() << " "
+           << precisionName(layer->getWeightPrecision()) << "\n";
+    layer->writeParams(writer);
+  }
+
+  config << "optimizer " << optimizer->typeName() << " ";
+  optimizer->saveState(layers, config, writer);
+  config << "\n";
+
+  writer.write(path, config.str());
+}
+
+/*
+ * @brief Build a model from an archive written by save
+ */
+template <typename T>
+std::unique_ptr<SequentialModel<T>>
+SequentialModel<T>::load(const std::string &path, bool map, bool verify) {
+  checkpoint::Reader reader(path, map, verify);
+  std::istringstream config(reader.metadata());
+
+  std::string magic;
+  int version = 0;
+  if (!(config >> magic >> version) || magic != archive_magic) {
+    throw std::runtime_error("Not a model archive: " + path);
+  }
+  if (version > archive_version) {
+    throw std::runtime_error("Model archive is newer than this build: " +
+                             path);
+  }
+  readField<std::string>(config, "scalar", path);
+  int total_epochs = readField<int>(config, "epochs", path);
+  bool fused = readField<int>(config, "fused_update", path) != 0;
+  std::string loss_type = readField<std::string>(config, "loss", path);
+  size_t count = readField<size_t>(config, "layers", path);
+
+  vector<std::unique_ptr<Layer<T>>> model_layers;
+  for (size_t i = 0; i < count; i++) {
+    std::string type, precision;
+    int input, output;
+    if (!(config >> type >> input >> output >> precision)) {
+      throw std::runtime_error("Corrupt model archive (layer " +
+                               std::to_string(i) + "): " + path);
+    }
+
+    std::unique_ptr<Layer<T>> layer =
+        Registry<T>::createLayer(type, input, output);
+    layer->setWeightPrecision(parsePrecision(precision));
+    layer->readParams(reader);
+    if (layer->getInputSize() != input || layer->getOutputSize() != output) {
+      throw std::runtime_error("Layer " + std::to_string(i) +
+                               " does not match its parameters: " + path);
+    }
+    model_layers.push_back(std::move(layer));
+  }
+
+  // the rest of the optimizer line is its own
+  std::string optimizer_type =
+      readField<std::string>(config, "optimizer", path);
+  std::string state;
+  std::getline(config, state);
+  std::istringstream state_config(state);
+
+  std::unique_ptr<Optimizer<T>> model_optimizer =
+      Registry<T>::createOptimizer(optimizer_type);
+  model_optimizer->loadState(model_layers, state_config, reader);
+
+  if (reader.remaining() != 0) {
+    throw std::runtime_error("Model archive has unused tensors: " + path);
+  }
+
+  auto model = std::make_unique<SequentialModel<T>>(
+      std::move(model_layers), Registry<T>::createLoss(loss_type),
+      std::move(model_optimizer), total_epochs);
+  model->setFusedUpdate(fused);
+  return model;
+}
+
+template class SequentialModel<float>;
+template class SequentialModel<double>;
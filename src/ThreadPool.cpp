@@ -0,0 +1,126 @@
+#include "../include/ThreadPool.h"
+#include <stdexcept>
+
+/*
+ * @brief Start the workers
+ * @param size number of threads including the caller
+ */
+ThreadPool::ThreadPool(size_t size)
+    : task(nullptr), count(0), each(false), next(0), busy(0), generation(0),
+      stopping(false) {
+  if (size < 1) {
+    throw std::invalid_argument("Thread count must be positive");
+  }
+
+  for (size_t worker = 1; worker < size; worker++) {
+    threads.emplace_back(&ThreadPool::run, this, worker);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start.notify_all();
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+/*
+ * @brief Run task(index, worker) for every index in [0, count) and wait
+ */
+void ThreadPool::parallelFor(size_t loop_count, const Task &loop_task) {
+  if (loop_count == 0)
+    return;
+  post(loop_count, loop_task, false);
+}
+
+/*
+ * @brief Run task(worker, worker) once on every thread and wait
+ */
+void ThreadPool::runOnEach(const Task &loop_task) {
+  post(size(), loop_task, true);
+}
+
+/*
+ * @brief Start a loop, take part in it and wait for its end
+ */
+void ThreadPool::post(size_t loop_count, const Task &loop_task,
+                      bool on_each) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &loop_task;
+    count = loop_count;
+    each = on_each;
+    next.store(0, std::memory_order_relaxed);
+    busy = threads.size();
+    error = nullptr;
+    generation++;
+  }
+  start.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return busy == 0; });
+  task = nullptr;
+
+  if (error) {
+    std::exception_ptr thrown = error;
+    error = nullptr;
+    std::rethrow_exception(thrown);
+  }
+}
+
+/*
+ * @brief Run indices of the current loop until none is left
+ */
+void ThreadPool::work(size_t worker) {
+  if (each) {
+    try {
+      (*task)(worker, worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+    return;
+  }
+
+  for (size_t index = next.fetch_add(1, std::memory_order_relaxed);
+       index < count; index = next.fetch_add(1, std::memory_order_relaxed)) {
+    try {
+      (*task)(index, worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+}
+
+/*
+ * @brief Wait for loops and take part in them until stopped
+ */
+void ThreadPool::run(size_t worker) {
+  size_t seen = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+    }
+
+    work(worker);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
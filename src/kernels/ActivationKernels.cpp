@@ -0,0 +1,317 @@
+#include "../../include/kernels/ActivationKernels.h"
+#include "../../include/Activation.h"
+#include "VecMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace kernels {
+
+namespace {
+
+using namespace vecmath;
+
+/*
+ * @brief Apply Op::apply to n values, finishing the tail through a zero
+ * padded vector so every element takes the same code path
+ */
+template <typename T, int VecBytes, typename Op>
+EASYLEARN_INLINE void mapUnary(const T *in, T *out, size_t n) {
+  typedef typename VecTypes<T, VecBytes>::Vec Vec;
+  constexpr size_t lanes = VecTypes<T, VecBytes>::lanes;
+  size_t i = 0;
+
+  for (; i + lanes <= n; i += lanes) {
+    store(out + i, Op::template apply<T, VecBytes>(load<Vec>(in + i)));
+  }
+
+  if (i < n) {
+    T tail[lanes] = {};
+    std::memcpy(tail, in + i, (n - i) * sizeof(T));
+    Vec result = Op::template apply<T, VecBytes>(load<Vec>(tail));
+    std::memcpy(out + i, &result, (n - i) * sizeof(T));
+  }
+}
+
+/*
+ * @brief Apply Op::apply to n pairs of (value, gradient)
+ */
+template <typename T, int VecBytes, typename Op>
+EASYLEARN_INLINE void mapBinary(const T *a, const T *b, T *out, size_t n) {
+  typedef typename VecTypes<T, VecBytes>::Vec Vec;
+  constexpr size_t lanes = VecTypes<T, VecBytes>::lanes;
+  size_t i = 0;
+
+  for (; i + lanes <= n; i += lanes) {
+    store(out + i, Op::template apply<T, VecBytes>(load<Vec>(a + i),
+                                                   load<Vec>(b + i)));
+  }
+
+  if (i < n) {
+    T tail_a[lanes] = {};
+    T tail_b[lanes] = {};
+    std::memcpy(tail_a, a + i, (n - i) * sizeof(T));
+    std::memcpy(tail_b, b + i, (n - i) * sizeof(T));
+    Vec result =
+        Op::template apply<T, VecBytes>(load<Vec>(tail_a), load<Vec>(tail_b));
+    std::memcpy(out + i, &result, (n - i) * sizeof(T));
+  }
+}
+
+#define EASYLEARN_VEC typename VecTypes<T, VecBytes>::Vec
+
+struct ReluOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return z > T(0) ? z : T(0);
+  }
+};
+
+struct ReluDerivativeOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z,
+                                              EASYLEARN_VEC grad) {
+    return z > T(0) ? grad : T(0);
+  }
+};
+
+struct LeakyReluOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return z > T(0) ? z : z * T(activation::leaky_relu_slope);
+  }
+};
+
+struct LeakyReluDerivativeOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z,
+                                              EASYLEARN_VEC grad) {
+    return z > T(0) ? grad : grad * T(activation::leaky_relu_slope);
+  }
+};
+
+struct SigmoidOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return vecmath::sigmoid<T, VecBytes>(z);
+  }
+};
+
+struct SigmoidDerivativeOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC y,
+                                              EASYLEARN_VEC grad) {
+    return grad * y * (T(1) - y);
+  }
+};
+
+struct TanhOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return vecmath::tanh<T, VecBytes>(z);
+  }
+};
+
+struct FastSigmoidOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return vecmath::fastSigmoid<T, VecBytes>(z);
+  }
+};
+
+struct FastTanhOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC z) {
+    return vecmath::fastTanh<T, VecBytes>(z);
+  }
+};
+
+struct TanhDerivativeOp {
+  template <typename T, int VecBytes>
+  static EASYLEARN_INLINE EASYLEARN_VEC apply(EASYLEARN_VEC y,
+                                              EASYLEARN_VEC grad) {
+    return grad * (T(1) - y * y);
+  }
+};
+
+#undef EASYLEARN_VEC
+
+// Scalar fallback built on the C library
+template <typename T> struct Scalar {
+  static void relu(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = z[i] > T(0) ? z[i] : T(0);
+    }
+  }
+
+  static void relu_derivative(const T *z, const T *grad, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = z[i] > T(0) ? grad[i] : T(0);
+    }
+  }
+
+  static void leaky_relu(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = z[i] > T(0) ? z[i] : z[i] * T(activation::leaky_relu_slope);
+    }
+  }
+
+  static void leaky_relu_derivative(const T *z, const T *grad, T *out,
+                                    size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] =
+          z[i] > T(0) ? grad[i] : grad[i] * T(activation::leaky_relu_slope);
+    }
+  }
+
+  static void sigmoid(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = T(1) / (T(1) + std::exp(-z[i]));
+    }
+  }
+
+  static void sigmoid_derivative(const T *y, const T *grad, T *out,
+                                 size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = grad[i] * y[i] * (T(1) - y[i]);
+    }
+  }
+
+  static void tanh(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = std::tanh(z[i]);
+    }
+  }
+
+  static void tanh_derivative(const T *y, const T *grad, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = grad[i] * (T(1) - y[i] * y[i]);
+    }
+  }
+
+  // Same rational approximation as vecmath::fastTanh
+  static T fastTanh(T x) {
+    x = std::min(T(4.8), std::max(T(-4.8), x));
+
+    T s = x * x;
+    T p = ((s + T(378)) * s + T(17325)) * s + T(135135);
+    T q = ((s * T(28) + T(3150)) * s + T(62370)) * s + T(135135);
+    return std::min(T(1), std::max(T(-1), x * p / q));
+  }
+
+  static void fast_sigmoid(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = T(0.5) + T(0.5) * fastTanh(T(0.5) * z[i]);
+    }
+  }
+
+  static void fast_tanh(const T *z, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = fastTanh(z[i]);
+    }
+  }
+
+  static const ActivationKernels<T> table;
+};
+
+template <typename T>
+const ActivationKernels<T> Scalar<T>::table = {
+    relu,         relu_derivative, leaky_relu, leaky_relu_derivative,
+    sigmoid,      sigmoid_derivative, tanh,    tanh_derivative,
+    fast_sigmoid, fast_tanh};
+
+// One entry point per kernel and instruction set; the always_inline bodies
+// above are expanded inside them and so use that target's registers
+#define EASYLEARN_ACTIVATION_VARIANT(name, isa, bytes)                        \
+  template <typename T> struct name {                                         \
+    EASYLEARN_TARGET(isa) static void relu(const T *z, T *out, size_t n) {    \
+      mapUnary<T, bytes, ReluOp>(z, out, n);                                  \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void relu_derivative(const T *z, const T *g, T *out, size_t n) {   \
+      mapBinary<T, bytes, ReluDerivativeOp>(z, g, out, n);                    \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void leaky_relu(const T *z, T *out, size_t n) {                    \
+      mapUnary<T, bytes, LeakyReluOp>(z, out, n);                             \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void leaky_relu_derivative(const T *z, const T *g, T *out,         \
+                                      size_t n) {                             \
+      mapBinary<T, bytes, LeakyReluDerivativeOp>(z, g, out, n);               \
+    }                                                                         \
+    EASYLEARN_TARGET(isa) static void sigmoid(const T *z, T *out, size_t n) { \
+      mapUnary<T, bytes, SigmoidOp>(z, out, n);                               \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void sigmoid_derivative(const T *y, const T *g, T *out,            \
+                                   size_t n) {                                \
+      mapBinary<T, bytes, SigmoidDerivativeOp>(y, g, out, n);                 \
+    }                                                                         \
+    EASYLEARN_TARGET(isa) static void tanh(const T *z, T *out, size_t n) {    \
+      mapUnary<T, bytes, TanhOp>(z, out, n);                                  \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void tanh_derivative(const T *y, const T *g, T *out, size_t n) {   \
+      mapBinary<T, bytes, TanhDerivativeOp>(y, g, out, n);                    \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void fast_sigmoid(const T *z, T *out, size_t n) {                  \
+      mapUnary<T, bytes, FastSigmoidOp>(z, out, n);                           \
+    }                                                                         \
+    EASYLEARN_TARGET(isa)                                                     \
+    static void fast_tanh(const T *z, T *out, size_t n) {                     \
+      mapUnary<T, bytes, FastTanhOp>(z, out, n);                              \
+    }                                                                         \
+    static const ActivationKernels<T> table;                                  \
+  };                                                                          \
+  template <typename T>                                                       \
+  const ActivationKernels<T> name<T>::table = {                               \
+      relu,         relu_derivative,    leaky_relu, leaky_relu_derivative,    \
+      sigmoid,      sigmoid_derivative, tanh,       tanh_derivative,          \
+      fast_sigmoid, fast_tanh};
+
+#if EASYLEARN_X86
+EASYLEARN_ACTIVATION_VARIANT(Sse2, "sse2", 16)
+EASYLEARN_ACTIVATION_VARIANT(Avx2, "avx2,fma", 32)
+EASYLEARN_ACTIVATION_VARIANT(Avx512, "avx512f", 64)
+#endif
+
+#undef EASYLEARN_ACTIVATION_VARIANT
+
+} // namespace
+
+/*
+ * @brief Get the activation kernels for the best instruction set of this CPU
+ */
+template <typename T> const ActivationKernels<T> &activationKernels() {
+  static const ActivationKernels<T> &best =
+      activationKernels<T>(detectedIsa());
+  return best;
+}
+
+/*
+ * @brief Get the activation kernels for a given instruction set
+ * @param isa instruction set; must be supported by the CPU
+ */
+template <typename T> const ActivationKernels<T> &activationKernels(Isa isa) {
+#if EASYLEARN_X86
+  switch (isa) {
+  case Isa::AVX512:
+    return Avx512<T>::table;
+  case Isa::AVX2:
+    return Avx2<T>::table;
+  case Isa::SSE2:
+    return Sse2<T>::table;
+  default:
+    break;
+  }
+#endif
+  return Scalar<T>::table;
+}
+
+template const ActivationKernels<float> &activationKernels<float>();
+template const ActivationKernels<double> &activationKernels<double>();
+template const ActivationKernels<float> &activationKernels<float>(Isa);
+template const ActivationKernels<double> &activationKernels<double>(Isa);
+
+} // namespace kernels
@@ -0,0 +1,48 @@
+#include "../../include/kernels/Cpu.h"
+
+namespace kernels {
+
+namespace {
+
+Isa queryIsa() {
+#if EASYLEARN_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f"))
+    return Isa::AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Isa::AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return Isa::SSE2;
+#endif
+  return Isa::Scalar;
+}
+
+} // namespace
+
+/*
+ * @brief Get the best instruction set supported by this CPU
+ * @return instruction set level (queried once via cpuid)
+ */
+Isa detectedIsa() {
+  static const Isa isa = queryIsa();
+  return isa;
+}
+
+/*
+ * @brief Get a printable name of an instruction set level
+ */
+const char *isaName(Isa isa) {
+  switch (isa) {
+  case Isa::AVX512:
+    return "AVX-512";
+  case Isa::AVX2:
+    return "AVX2";
+  case Isa::SSE2:
+    return "SSE2";
+  default:
+    return "scalar";
+  }
+}
+
+} // namespace kernels
@@ -0,0 +1,523 @@
+#include "../../include/kernels/Gemm.h"
+#include "../../include/kernels/Cpu.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace kernels {
+
+namespace {
+
+/*
+ * @brief Register and cache blocking for one element type and SIMD width
+ *
+ * The micro-kernel keeps an MR x NR tile of C in registers. A block of
+ * MC x KC values of A stays in L2 and a KC x NR sliver of B in L1 while the
+ * micro-kernel runs over it; NC bounds the packed block of B.
+ */
+template <typename T, int VecBytes> struct Blocking {
+  typedef T Vec __attribute__((vector_size(VecBytes)));
+  static constexpr int lanes = VecBytes / sizeof(T);
+  static constexpr int MR = VecBytes == 64 ? 8 : (VecBytes == 32 ? 6 : 4);
+  static constexpr int NR = 2 * lanes;
+  static constexpr size_t MC = MR * (VecBytes == 16 ? 16 : 12);
+  static constexpr size_t KC = 256;
+  static constexpr size_t NC = 4080 / NR * NR;
+};
+
+/*
+ * @brief Per-thread aligned scratch used to pack operands
+ */
+class PackBuffer {
+private:
+  void *storage = nullptr;
+  size_t capacity = 0; // bytes
+
+public:
+  ~PackBuffer() { std::free(storage); }
+
+  template <typename T> T *get(size_t count) {
+    size_t bytes = (count * sizeof(T) + 63) / 64 * 64;
+
+    if (bytes > capacity) {
+      std::free(storage);
+      storage = std::aligned_alloc(64, bytes);
+      if (storage == nullptr) {
+        capacity = 0;
+        throw std::bad_alloc();
+      }
+      capacity = bytes;
+    }
+    return static_cast<T *>(storage);
+  }
+};
+
+PackBuffer &packBufferA() {
+  static thread_local PackBuffer buffer;
+  return buffer;
+}
+
+PackBuffer &packBufferB() {
+  static thread_local PackBuffer buffer;
+  return buffer;
+}
+
+/*
+ * @brief Copy an mc x kc block of op(A) into MR-row panels (zero padded)
+ */
+template <typename T, int MR>
+EASYLEARN_INLINE void packA(bool trans, const T *a, size_t lda, size_t mc,
+                            size_t kc, T *packed) {
+  for (size_t i = 0; i < mc; i += MR) {
+    size_t rows = std::min<size_t>(MR, mc - i);
+
+    for (size_t p = 0; p < kc; p++) {
+      for (size_t r = 0; r < rows; r++) {
+        packed[r] = trans ? a[p * lda + i + r] : a[(i + r) * lda + p];
+      }
+      for (size_t r = rows; r < MR; r++) {
+        packed[r] = T(0);
+      }
+      packed += MR;
+    }
+  }
+}
+
+/*
+ * @brief Copy a kc x nc block of op(B) into NR-column panels (zero padded)
+ */
+template <typename T, int NR>
+EASYLEARN_INLINE void packB(bool trans, const T *b, size_t ldb, size_t kc,
+                            size_t nc, T *packed) {
+  for (size_t j = 0; j < nc; j += NR) {
+    size_t cols = std::min<size_t>(NR, nc - j);
+
+    for (size_t p = 0; p < kc; p++) {
+      for (size_t c = 0; c < cols; c++) {
+        packed[c] = trans ? b[(j + c) * ldb + p] : b[p * ldb + j + c];
+      }
+      for (size_t c = cols; c < NR; c++) {
+        packed[c] = T(0);
+      }
+      packed += NR;
+    }
+  }
+}
+
+/*
+ * @brief Multiply an MR-row panel of A by an NR-column panel of B and
+ * merge the mr x nr valid part of the product into C
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE void microKernel(size_t kc, const T *a, const T *b, T alpha,
+                                  T beta, T *c, size_t ldc, size_t mr,
+                                  size_t nr) {
+  typedef Blocking<T, VecBytes> B;
+  typedef typename B::Vec Vec;
+  constexpr int MR = B::MR;
+  constexpr int NV = B::NR / B::lanes;
+
+  Vec acc[MR][NV] = {};
+
+  for (size_t p = 0; p < kc; p++) {
+    Vec bv[NV];
+#pragma GCC unroll 8
+    for (int v = 0; v < NV; v++) {
+      bv[v] = *reinterpret_cast<const Vec *>(b + v * B::lanes);
+    }
+#pragma GCC unroll 16
+    for (int r = 0; r < MR; r++) {
+#pragma GCC unroll 8
+      for (int v = 0; v < NV; v++) {
+        acc[r][v] += a[r] * bv[v];
+      }
+    }
+    a += MR;
+    b += B::NR;
+  }
+
+  if (mr == MR && nr == B::NR) {
+#pragma GCC unroll 16
+    for (int r = 0; r < MR; r++) {
+#pragma GCC unroll 8
+      for (int v = 0; v < NV; v++) {
+        T *dst = c + r * ldc + v * B::lanes;
+        Vec result = alpha * acc[r][v];
+        if (beta != T(0)) {
+          Vec old;
+          std::memcpy(&old, dst, sizeof(Vec));
+          result += beta * old;
+        }
+        std::memcpy(dst, &result, sizeof(Vec));
+      }
+    }
+    return;
+  }
+
+  // Edge tile: spill the accumulators and copy only the valid part
+  alignas(64) T tile[MR][B::NR];
+  std::memcpy(tile, acc, sizeof(tile));
+
+  for (size_t r = 0; r < mr; r++) {
+    for (size_t j = 0; j < nr; j++) {
+      T result = alpha * tile[r][j];
+      if (beta != T(0))
+        result += beta * c[r * ldc + j];
+      c[r * ldc + j] = result;
+    }
+  }
+}
+
+/*
+ * @brief Scale C by beta (beta == 0 clears C without reading it)
+ */
+template <typename T>
+void scale(size_t m, size_t n, T beta, T *c, size_t ldc) {
+  for (size_t i = 0; i < m; i++) {
+    T *row = c + i * ldc;
+    for (size_t j = 0; j < n; j++) {
+      row[j] = beta == T(0) ? T(0) : beta * row[j];
+    }
+  }
+}
+
+/*
+ * @brief Cache-blocked packed GEMM (see kernels::gemm)
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE void gemmBlocked(bool trans_a, bool trans_b, size_t m,
+                                  size_t n, size_t k, T alpha, const T *a,
+                                  size_t lda, const T *b, size_t ldb, T beta,
+                                  T *c, size_t ldc) {
+  typedef Blocking<T, VecBytes> B;
+
+  T *packed_a = packBufferA().get<T>(B::MC * B::KC);
+  T *packed_b = packBufferB().get<T>(B::KC * B::NC);
+
+  for (size_t jc = 0; jc < n; jc += B::NC) {
+    size_t nc = std::min(B::NC, n - jc);
+
+    for (size_t pc = 0; pc < k; pc += B::KC) {
+      size_t kc = std::min(B::KC, k - pc);
+      // later K blocks accumulate onto the partial result
+      T beta_block = pc == 0 ? beta : T(1);
+
+      const T *b_block = trans_b ? b + jc * ldb + pc : b + pc * ldb + jc;
+      packB<T, B::NR>(trans_b, b_block, ldb, kc, nc, packed_b);
+
+      for (size_t ic = 0; ic < m; ic += B::MC) {
+        size_t mc = std::min(B::MC, m - ic);
+
+        const T *a_block = trans_a ? a + pc * lda + ic : a + ic * lda + pc;
+        packA<T, B::MR>(trans_a, a_block, lda, mc, kc, packed_a);
+
+        for (size_t jr = 0; jr < nc; jr += B::NR) {
+          for (size_t ir = 0; ir < mc; ir += B::MR) {
+            microKernel<T, VecBytes>(
+                kc, packed_a + ir * kc, packed_b + jr * kc, alpha, beta_block,
+                c + (ic + ir) * ldc + jc + jr, ldc,
+                std::min<size_t>(B::MR, mc - ir),
+                std::min<size_t>(B::NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+/*
+ * @brief Matrix-vector product (see kernels::gemv)
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE void gemvImpl(bool trans, size_t m, size_t n, T alpha,
+                               const T *a, size_t lda, const T *x, T beta,
+                               T *y) {
+  typedef typename Blocking<T, VecBytes>::Vec Vec;
+  constexpr size_t lanes = Blocking<T, VecBytes>::lanes;
+
+  if (!trans) {
+    // y[i] = alpha * dot(A[i], x) + beta * y[i]
+    for (size_t i = 0; i < m; i++) {
+      const T *row = a + i * lda;
+      Vec acc0 = {}, acc1 = {};
+      size_t j = 0;
+
+      for (; j + 2 * lanes <= n; j += 2 * lanes) {
+        Vec a0, a1, x0, x1;
+        std::memcpy(&a0, row + j, sizeof(Vec));
+        std::memcpy(&a1, row + j + lanes, sizeof(Vec));
+        std::memcpy(&x0, x + j, sizeof(Vec));
+        std::memcpy(&x1, x + j + lanes, sizeof(Vec));
+        acc0 += a0 * x0;
+        acc1 += a1 * x1;
+      }
+      acc0 += acc1;
+
+      T sum = T(0);
+      for (size_t l = 0; l < lanes; l++) {
+        sum += acc0[l];
+      }
+      for (; j < n; j++) {
+        sum += row[j] * x[j];
+      }
+
+      y[i] = alpha * sum + (beta == T(0) ? T(0) : beta * y[i]);
+    }
+    return;
+  }
+
+  // y = alpha * sum_i x[i] * A[i] + beta * y, streaming A row by row
+  scale<T>(1, n, beta, y, n);
+
+  for (size_t i = 0; i < m; i++) {
+    const T *row = a + i * lda;
+    T factor = alpha * x[i];
+    size_t j = 0;
+
+    for (; j + lanes <= n; j += lanes) {
+      Vec av, yv;
+      std::memcpy(&av, row + j, sizeof(Vec));
+      std::memcpy(&yv, y + j, sizeof(Vec));
+      yv += factor * av;
+      std::memcpy(y + j, &yv, sizeof(Vec));
+    }
+    for (; j < n; j++) {
+      y[j] += factor * row[j];
+    }
+  }
+}
+
+/*
+ * @brief y = alpha * x + y over n contiguous values
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE void axpyImpl(size_t n, T alpha, const T *x, T *y) {
+  typedef typename Blocking<T, VecBytes>::Vec Vec;
+  constexpr size_t lanes = Blocking<T, VecBytes>::lanes;
+  size_t i = 0;
+
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    Vec x0, x1, y0, y1;
+    std::memcpy(&x0, x + i, sizeof(Vec));
+    std::memcpy(&x1, x + i + lanes, sizeof(Vec));
+    std::memcpy(&y0, y + i, sizeof(Vec));
+    std::memcpy(&y1, y + i + lanes, sizeof(Vec));
+    y0 += alpha * x0;
+    y1 += alpha * x1;
+    std::memcpy(y + i, &y0, sizeof(Vec));
+    std::memcpy(y + i + lanes, &y1, sizeof(Vec));
+  }
+  for (; i < n; i++) {
+    y[i] += alpha * x[i];
+  }
+}
+
+/*
+ * @brief Kernel entry points for one element type, one per instruction set
+ */
+template <typename T> struct Variants {
+  typedef void (*GemmFn)(bool, bool, size_t, size_t, size_t, T, const T *,
+                         size_t, const T *, size_t, T, T *, size_t);
+  typedef void (*GemvFn)(bool, size_t, size_t, T, const T *, size_t,
+                         const T *, T, T *);
+  typedef void (*AxpyFn)(size_t, T, const T *, T *);
+
+#if EASYLEARN_X86
+  EASYLEARN_TARGET("avx512f")
+  static void gemmAvx512(bool ta, bool tb, size_t m, size_t n, size_t k,
+                         T alpha, const T *a, size_t lda, const T *b,
+                         size_t ldb, T beta, T *c, size_t ldc) {
+    gemmBlocked<T, 64>(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+  }
+
+  EASYLEARN_TARGET("avx2,fma")
+  static void gemmAvx2(bool ta, bool tb, size_t m, size_t n, size_t k,
+                       T alpha, const T *a, size_t lda, const T *b, size_t ldb,
+                       T beta, T *c, size_t ldc) {
+    gemmBlocked<T, 32>(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+  }
+
+  EASYLEARN_TARGET("avx512f")
+  static void gemvAvx512(bool trans, size_t m, size_t n, T alpha, const T *a,
+                         size_t lda, const T *x, T beta, T *y) {
+    gemvImpl<T, 64>(trans, m, n, alpha, a, lda, x, beta, y);
+  }
+
+  EASYLEARN_TARGET("avx2,fma")
+  static void gemvAvx2(bool trans, size_t m, size_t n, T alpha, const T *a,
+                       size_t lda, const T *x, T beta, T *y) {
+    gemvImpl<T, 32>(trans, m, n, alpha, a, lda, x, beta, y);
+  }
+
+  EASYLEARN_TARGET("avx512f")
+  static void axpyAvx512(size_t n, T alpha, const T *x, T *y) {
+    axpyImpl<T, 64>(n, alpha, x, y);
+  }
+
+  EASYLEARN_TARGET("avx2,fma")
+  static void axpyAvx2(size_t n, T alpha, const T *x, T *y) {
+    axpyImpl<T, 32>(n, alpha, x, y);
+  }
+#endif
+
+  static void gemmGeneric(bool ta, bool tb, size_t m, size_t n, size_t k,
+                          T alpha, const T *a, size_t lda, const T *b,
+                          size_t ldb, T beta, T *c, size_t ldc) {
+    gemmBlocked<T, 16>(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+  }
+
+  static void gemvGeneric(bool trans, size_t m, size_t n, T alpha, const T *a,
+                          size_t lda, const T *x, T beta, T *y) {
+    gemvImpl<T, 16>(trans, m, n, alpha, a, lda, x, beta, y);
+  }
+
+  static void axpyGeneric(size_t n, T alpha, const T *x, T *y) {
+    axpyImpl<T, 16>(n, alpha, x, y);
+  }
+
+  static GemmFn selectGemm() {
+#if EASYLEARN_X86
+    switch (detectedIsa()) {
+    case Isa::AVX512:
+      return gemmAvx512;
+    case Isa::AVX2:
+      return gemmAvx2;
+    default:
+      break;
+    }
+#endif
+    return gemmGeneric;
+  }
+
+  static GemvFn selectGemv() {
+#if EASYLEARN_X86
+    switch (detectedIsa()) {
+    case Isa::AVX512:
+      return gemvAvx512;
+    case Isa::AVX2:
+      return gemvAvx2;
+    default:
+      break;
+    }
+#endif
+    return gemvGeneric;
+  }
+
+  static AxpyFn selectAxpy() {
+#if EASYLEARN_X86
+    switch (detectedIsa()) {
+    case Isa::AVX512:
+      return axpyAvx512;
+    case Isa::AVX2:
+      return axpyAvx2;
+    default:
+      break;
+    }
+#endif
+    return axpyGeneric;
+  }
+};
+
+} // namespace
+
+/*
+ * @brief General matrix multiplication C = alpha * op(A) * op(B) + beta * C
+ */
+template <typename T>
+void gemm(Transpose trans_a, Transpose trans_b, size_t m, size_t n, size_t k,
+          T alpha, const T *a, size_t lda, const T *b, size_t ldb, T beta,
+          T *c, size_t ldc) {
+  static const typename Variants<T>::GemmFn gemm_impl =
+      Variants<T>::selectGemm();
+  static const typename Variants<T>::GemvFn gemv_impl =
+      Variants<T>::selectGemv();
+  bool ta = trans_a == Transpose::Yes;
+  bool tb = trans_b == Transpose::Yes;
+
+  if (m == 0 || n == 0)
+    return;
+
+  if (k == 0 || alpha == T(0)) {
+    scale(m, n, beta, c, ldc);
+    return;
+  }
+
+  // Single row of C: a vector-matrix product, packing would not pay off
+  if (m == 1 && (!ta || lda == 1)) {
+    // op(B) * a as a product with B (tb) or its transpose (!tb)
+    if (tb)
+      gemv_impl(false, n, k, alpha, b, ldb, a, beta, c);
+    else
+      gemv_impl(true, k, n, alpha, b, ldb, a, beta, c);
+    return;
+  }
+
+  // Inner dimension of one: rank-1 update C = alpha * a * b^T + beta * C
+  if (k == 1) {
+    for (size_t i = 0; i < m; i++) {
+      T factor = alpha * (ta ? a[i] : a[i * lda]);
+      T *row = c + i * ldc;
+      for (size_t j = 0; j < n; j++) {
+        T value = factor * (tb ? b[j * ldb] : b[j]);
+        row[j] = beta == T(0) ? value : value + beta * row[j];
+      }
+    }
+    return;
+  }
+
+  gemm_impl(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+/*
+ * @brief Matrix-vector product y = alpha * op(A) * x + beta * y
+ */
+template <typename T>
+void gemv(Transpose trans, size_t m, size_t n, T alpha, const T *a, size_t lda,
+          const T *x, T beta, T *y) {
+  static const typename Variants<T>::GemvFn gemv_impl =
+      Variants<T>::selectGemv();
+  gemv_impl(trans == Transpose::Yes, m, n, alpha, a, lda, x, beta, y);
+}
+
+/*
+ * @brief Scaled vector addition y = alpha * x + y
+ */
+template <typename T> void axpy(size_t n, T alpha, const T *x, T *y) {
+  static const typename Variants<T>::AxpyFn axpy_impl =
+      Variants<T>::selectAxpy();
+  axpy_impl(n, alpha, x, y);
+}
+
+template <typename T>
+void atomicAxpy(size_t n, T alpha, const T *x, T *y) {
+  for (size_t i = 0; i < n; i++) {
+    if (x[i] == T(0))
+      continue;
+
+    T expected;
+    __atomic_load(y + i, &expected, __ATOMIC_RELAXED);
+    T desired;
+    do {
+      desired = expected + alpha * x[i];
+    } while (!__atomic_compare_exchange(y + i, &expected, &desired, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+template void gemm<float>(Transpose, Transpose, size_t, size_t, size_t, float,
+                          const float *, size_t, const float *, size_t, float,
+                          float *, size_t);
+template void gemm<double>(Transpose, Transpose, size_t, size_t, size_t,
+                           double, const double *, size_t, const double *,
+                           size_t, double, double *, size_t);
+template void gemv<float>(Transpose, size_t, size_t, float, const float *,
+                          size_t, const float *, float, float *);
+template void gemv<double>(Transpose, size_t, size_t, double, const double *,
+                           size_t, const double *, double, double *);
+template void axpy<float>(size_t, float, const float *, float *);
+template void axpy<double>(size_t, double, const double *, double *);
+template void atomicAxpy<float>(size_t, float, const float *, float *);
+template void atomicAxpy<double>(size_t, double, const double *, double *);
+
+} // namespace kernels
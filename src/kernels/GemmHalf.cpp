@@ -0,0 +1,261 @@
+#include "../../include/kernels/Cpu.h"
+#include "../../include/kernels/Gemm.h"
+#include "../../include/kernels/Half.h"
+#include <algorithm>
+#include <vector>
+
+#if EASYLEARN_X86
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+
+namespace {
+
+// Values of a widened slice of B: 256 KB of float, half of a typical L2,
+// so the slice is still cached when the GEMM packs it
+const size_t widen_slice = 64 * 1024;
+
+template <typename T> T *sliceBuffer(size_t count) {
+  static thread_local std::vector<T> buffer;
+  if (buffer.size() < count)
+    buffer.resize(count);
+  return buffer.data();
+}
+
+// A single sample times a weight matrix is bound by memory bandwidth, so
+// it gets a kernel that widens weights in registers instead of through a
+// slice buffer. Intrinsics only inline into functions of the same target:
+// the helpers carry their target and the entry points are flattened.
+
+#if EASYLEARN_X86
+template <bool BFloat16> struct Avx512 {
+  typedef __m512 Acc;
+  static constexpr size_t lanes = 16;
+
+  EASYLEARN_TARGET("avx512f")
+  static inline Acc zero() { return _mm512_setzero_ps(); }
+
+  EASYLEARN_TARGET("avx512f")
+  static inline Acc loadX(const float *p) { return _mm512_loadu_ps(p); }
+
+  EASYLEARN_TARGET("avx512f")
+  static inline Acc loadW(const uint16_t *p) {
+    __m256i half = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    if (BFloat16)
+      return _mm512_castsi512_ps(
+          _mm512_slli_epi32(_mm512_cvtepu16_epi32(half), 16));
+    return _mm512_cvtph_ps(half);
+  }
+
+  EASYLEARN_TARGET("avx512f")
+  static inline Acc fma(Acc acc, Acc w, Acc x) {
+    return _mm512_fmadd_ps(w, x, acc);
+  }
+
+  EASYLEARN_TARGET("avx512f")
+  static inline float sum(Acc acc) { return _mm512_reduce_add_ps(acc); }
+};
+
+template <bool BFloat16> struct Avx2 {
+  typedef __m256 Acc;
+  static constexpr size_t lanes = 8;
+
+  EASYLEARN_TARGET("avx2,fma,f16c")
+  static inline Acc zero() { return _mm256_setzero_ps(); }
+
+  EASYLEARN_TARGET("avx2,fma,f16c")
+  static inline Acc loadX(const float *p) { return _mm256_loadu_ps(p); }
+
+  EASYLEARN_TARGET("avx2,fma,f16c")
+  static inline Acc loadW(const uint16_t *p) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    if (BFloat16)
+      return _mm256_castsi256_ps(
+          _mm256_slli_epi32(_mm256_cvtepu16_epi32(half), 16));
+    return _mm256_cvtph_ps(half);
+  }
+
+  EASYLEARN_TARGET("avx2,fma,f16c")
+  static inline Acc fma(Acc acc, Acc w, Acc x) {
+    return _mm256_fmadd_ps(w, x, acc);
+  }
+
+  EASYLEARN_TARGET("avx2,fma,f16c")
+  static inline float sum(Acc acc) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc),
+                          _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  }
+};
+
+/*
+ * @brief y = alpha * W * x + beta * y for an n x k matrix W of 16-bit
+ * values, four rows at a time so each load of x feeds four products
+ */
+template <typename Ops>
+inline void gemvHalfImpl(size_t n, size_t k, float alpha, const uint16_t *w,
+                         size_t ldw, HalfFormat format, const float *x,
+                         float beta, float *y) {
+  typedef typename Ops::Acc Acc;
+  constexpr size_t lanes = Ops::lanes;
+  size_t j = 0;
+
+  for (; j < n; j += 4) {
+    size_t rows = std::min<size_t>(4, n - j);
+    const uint16_t *w0 = w + j * ldw;
+    const uint16_t *w1 = rows > 1 ? w0 + ldw : w0;
+    const uint16_t *w2 = rows > 2 ? w0 + 2 * ldw : w0;
+    const uint16_t *w3 = rows > 3 ? w0 + 3 * ldw : w0;
+    Acc acc0 = Ops::zero(), acc1 = Ops::zero();
+    Acc acc2 = Ops::zero(), acc3 = Ops::zero();
+    size_t p = 0;
+
+    for (; p + lanes <= k; p += lanes) {
+      Acc xv = Ops::loadX(x + p);
+      acc0 = Ops::fma(acc0, Ops::loadW(w0 + p), xv);
+      acc1 = Ops::fma(acc1, Ops::loadW(w1 + p), xv);
+      acc2 = Ops::fma(acc2, Ops::loadW(w2 + p), xv);
+      acc3 = Ops::fma(acc3, Ops::loadW(w3 + p), xv);
+    }
+
+    float sums[4] = {Ops::sum(acc0), Ops::sum(acc1), Ops::sum(acc2),
+                     Ops::sum(acc3)};
+    const uint16_t *rows_w[4] = {w0, w1, w2, w3};
+
+    for (size_t r = 0; r < rows; r++) {
+      for (size_t q = p; q < k; q++) {
+        sums[r] += halfToFloat(rows_w[r][q], format) * x[q];
+      }
+      float old = beta == 0.0f ? 0.0f : beta * y[j + r];
+      y[j + r] = alpha * sums[r] + old;
+    }
+  }
+}
+
+template <bool BFloat16>
+EASYLEARN_TARGET("avx512f") __attribute__((flatten))
+void gemvHalfAvx512(size_t n, size_t k, float alpha, const uint16_t *w,
+                    size_t ldw, HalfFormat format, const float *x, float beta,
+                    float *y) {
+  gemvHalfImpl<Avx512<BFloat16>>(n, k, alpha, w, ldw, format, x, beta, y);
+}
+
+template <bool BFloat16>
+EASYLEARN_TARGET("avx2,fma,f16c") __attribute__((flatten))
+void gemvHalfAvx2(size_t n, size_t k, float alpha, const uint16_t *w,
+                  size_t ldw, HalfFormat format, const float *x, float beta,
+                  float *y) {
+  gemvHalfImpl<Avx2<BFloat16>>(n, k, alpha, w, ldw, format, x, beta, y);
+}
+#endif
+
+typedef void (*GemvHalfFn)(size_t, size_t, float, const uint16_t *, size_t,
+                           HalfFormat, const float *, float, float *);
+
+/*
+ * @brief Pick the fused single-sample kernel for a format, or nullptr to
+ * use the slice path
+ */
+GemvHalfFn selectGemvHalf(HalfFormat format) {
+#if EASYLEARN_X86
+  bool bfloat16 = format == HalfFormat::BFloat16;
+
+  if (detectedIsa() == Isa::AVX512)
+    return bfloat16 ? gemvHalfAvx512<true> : gemvHalfAvx512<false>;
+  if (detectedIsa() == Isa::AVX2 && __builtin_cpu_supports("f16c"))
+    return bfloat16 ? gemvHalfAvx2<true> : gemvHalfAvx2<false>;
+#endif
+  (void)format;
+  return nullptr;
+}
+
+/*
+ * @brief Route y = alpha * W * x + beta * y to the fused kernel if there
+ * is one for T and this CPU
+ * @return false if the caller has to take the slice path
+ */
+template <typename T>
+bool gemvHalf(size_t, size_t, T, const uint16_t *, size_t, HalfFormat,
+              const T *, T, T *) {
+  return false;
+}
+
+template <>
+bool gemvHalf<float>(size_t n, size_t k, float alpha, const uint16_t *w,
+                     size_t ldw, HalfFormat format, const float *x,
+                     float beta, float *y) {
+  static const GemvHalfFn bfloat16 = selectGemvHalf(HalfFormat::BFloat16);
+  static const GemvHalfFn float16 = selectGemvHalf(HalfFormat::Float16);
+  GemvHalfFn impl = format == HalfFormat::BFloat16 ? bfloat16 : float16;
+
+  if (impl == nullptr)
+    return false;
+  impl(n, k, alpha, w, ldw, format, x, beta, y);
+  return true;
+}
+
+} // namespace
+
+/*
+ * @brief gemm with B stored as 16-bit floating point values
+ */
+template <typename T>
+void gemm(Transpose trans_a, Transpose trans_b, size_t m, size_t n, size_t k,
+          T alpha, const T *a, size_t lda, const uint16_t *b,
+          HalfFormat b_format, size_t ldb, T beta, T *c, size_t ldc) {
+  if (m == 0 || n == 0 || k == 0) {
+    gemm<T>(trans_a, trans_b, m, n, k, alpha, a, lda, nullptr, ldb, beta, c,
+            ldc);
+    return;
+  }
+
+  // Single sample times a transposed weight matrix (a layer's forward pass)
+  if (m == 1 && trans_b == Transpose::Yes &&
+      (trans_a == Transpose::No || lda == 1) &&
+      gemvHalf<T>(n, k, alpha, b, ldb, b_format, a, beta, c)) {
+    return;
+  }
+
+  if (trans_b == Transpose::Yes) {
+    // B is n x k: a slice of its rows gives a block of columns of C
+    size_t rows = std::max<size_t>(1, widen_slice / k);
+    T *slice = sliceBuffer<T>(std::min(rows, n) * k);
+
+    for (size_t j = 0; j < n; j += rows) {
+      size_t nb = std::min(rows, n - j);
+      for (size_t r = 0; r < nb; r++) {
+        widenHalf(b + (j + r) * ldb, slice + r * k, k, b_format);
+      }
+      gemm<T>(trans_a, Transpose::Yes, m, nb, k, alpha, a, lda, slice, k,
+              beta, c + j, ldc);
+    }
+    return;
+  }
+
+  // B is k x n: a slice of its rows is a block of the inner dimension,
+  // later blocks accumulate onto C
+  size_t rows = std::max<size_t>(1, widen_slice / n);
+  T *slice = sliceBuffer<T>(std::min(rows, k) * n);
+
+  for (size_t p = 0; p < k; p += rows) {
+    size_t kb = std::min(rows, k - p);
+    for (size_t r = 0; r < kb; r++) {
+      widenHalf(b + (p + r) * ldb, slice + r * n, n, b_format);
+    }
+    const T *a_block = trans_a == Transpose::Yes ? a + p * lda : a + p;
+    gemm<T>(trans_a, Transpose::No, m, n, kb, alpha, a_block, lda, slice, n,
+            p == 0 ? beta : T(1), c, ldc);
+  }
+}
+
+template void gemm<float>(Transpose, Transpose, size_t, size_t, size_t, float,
+                          const float *, size_t, const uint16_t *, HalfFormat,
+                          size_t, float, float *, size_t);
+template void gemm<double>(Transpose, Transpose, size_t, size_t, size_t,
+                           double, const double *, size_t, const uint16_t *,
+                           HalfFormat, size_t, double, double *, size_t);
+
+} // namespace kernels
@@ -0,0 +1,183 @@
+#include "../../include/kernels/Cpu.h"
+#include "../../include/kernels/Gemm.h"
+
+#if EASYLEARN_X86
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+
+namespace {
+
+// GCC does not turn __builtin_convertvector on int8 vectors into
+// sign-extending loads inside target() functions, so the int8 kernels use
+// intrinsics: widen to int16 and multiply-add pairs into int32 (pmaddwd).
+// Intrinsics only inline into functions of the same target, so the helpers
+// carry their target and the flattened entry points pull the shared loop
+// and the helpers into one body.
+
+/*
+ * @brief Dot product of two int8 rows of length k, scalar
+ */
+inline int32_t dotScalar(const int8_t *x, const int8_t *w, size_t k) {
+  int32_t sum = 0;
+  for (size_t p = 0; p < k; p++) {
+    sum += x[p] * w[p];
+  }
+  return sum;
+}
+
+#if EASYLEARN_X86
+struct Avx512 {
+  typedef __m512i Acc;
+  static constexpr size_t step = 32; // int8 values per multiply-add
+
+  EASYLEARN_TARGET("avx512f,avx512bw")
+  static inline Acc zero() { return _mm512_setzero_si512(); }
+
+  EASYLEARN_TARGET("avx512f,avx512bw")
+  static inline Acc widen(const int8_t *p) {
+    return _mm512_cvtepi8_epi16(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+  }
+
+  EASYLEARN_TARGET("avx512f,avx512bw")
+  static inline Acc madd(Acc acc, Acc x, Acc w) {
+    return _mm512_add_epi32(acc, _mm512_madd_epi16(x, w));
+  }
+
+  EASYLEARN_TARGET("avx512f,avx512bw")
+  static inline int32_t sum(Acc acc) {
+    return _mm512_reduce_add_epi32(acc);
+  }
+};
+
+struct Avx2 {
+  typedef __m256i Acc;
+  static constexpr size_t step = 16;
+
+  EASYLEARN_TARGET("avx2")
+  static inline Acc zero() { return _mm256_setzero_si256(); }
+
+  EASYLEARN_TARGET("avx2")
+  static inline Acc widen(const int8_t *p) {
+    return _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  }
+
+  EASYLEARN_TARGET("avx2")
+  static inline Acc madd(Acc acc, Acc x, Acc w) {
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(x, w));
+  }
+
+  EASYLEARN_TARGET("avx2")
+  static inline int32_t sum(Acc acc) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                              _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+  }
+};
+
+/*
+ * @brief C = A * B^T over int8 rows, four rows of B at a time so each
+ * widened chunk of A is reused by four accumulators
+ */
+template <typename Ops>
+inline void gemmInt8Impl(size_t m, size_t n, size_t k,
+                                   const int8_t *a, size_t lda,
+                                   const int8_t *b, size_t ldb, int32_t *c,
+                                   size_t ldc) {
+  typedef typename Ops::Acc Acc;
+  constexpr size_t step = Ops::step;
+
+  for (size_t i = 0; i < m; i++) {
+    const int8_t *x = a + i * lda;
+    int32_t *out = c + i * ldc;
+    size_t j = 0;
+
+    for (; j + 4 <= n; j += 4) {
+      const int8_t *w0 = b + j * ldb;
+      const int8_t *w1 = w0 + ldb;
+      const int8_t *w2 = w1 + ldb;
+      const int8_t *w3 = w2 + ldb;
+      Acc acc0 = Ops::zero(), acc1 = Ops::zero();
+      Acc acc2 = Ops::zero(), acc3 = Ops::zero();
+      size_t p = 0;
+
+      for (; p + step <= k; p += step) {
+        Acc xv = Ops::widen(x + p);
+        acc0 = Ops::madd(acc0, xv, Ops::widen(w0 + p));
+        acc1 = Ops::madd(acc1, xv, Ops::widen(w1 + p));
+        acc2 = Ops::madd(acc2, xv, Ops::widen(w2 + p));
+        acc3 = Ops::madd(acc3, xv, Ops::widen(w3 + p));
+      }
+
+      out[j] = Ops::sum(acc0) + dotScalar(x + p, w0 + p, k - p);
+      out[j + 1] = Ops::sum(acc1) + dotScalar(x + p, w1 + p, k - p);
+      out[j + 2] = Ops::sum(acc2) + dotScalar(x + p, w2 + p, k - p);
+      out[j + 3] = Ops::sum(acc3) + dotScalar(x + p, w3 + p, k - p);
+    }
+
+    for (; j < n; j++) {
+      const int8_t *w = b + j * ldb;
+      Acc acc = Ops::zero();
+      size_t p = 0;
+
+      for (; p + step <= k; p += step) {
+        acc = Ops::madd(acc, Ops::widen(x + p), Ops::widen(w + p));
+      }
+      out[j] = Ops::sum(acc) + dotScalar(x + p, w + p, k - p);
+    }
+  }
+}
+
+EASYLEARN_TARGET("avx512f,avx512bw") __attribute__((flatten))
+void gemmInt8Avx512(size_t m, size_t n, size_t k, const int8_t *a, size_t lda,
+                    const int8_t *b, size_t ldb, int32_t *c, size_t ldc) {
+  gemmInt8Impl<Avx512>(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+EASYLEARN_TARGET("avx2") __attribute__((flatten))
+void gemmInt8Avx2(size_t m, size_t n, size_t k, const int8_t *a, size_t lda,
+                  const int8_t *b, size_t ldb, int32_t *c, size_t ldc) {
+  gemmInt8Impl<Avx2>(m, n, k, a, lda, b, ldb, c, ldc);
+}
+#endif
+
+void gemmInt8Generic(size_t m, size_t n, size_t k, const int8_t *a,
+                     size_t lda, const int8_t *b, size_t ldb, int32_t *c,
+                     size_t ldc) {
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      c[i * ldc + j] = dotScalar(a + i * lda, b + j * ldb, k);
+    }
+  }
+}
+
+typedef void (*GemmInt8Fn)(size_t, size_t, size_t, const int8_t *, size_t,
+                           const int8_t *, size_t, int32_t *, size_t);
+
+GemmInt8Fn selectGemmInt8() {
+#if EASYLEARN_X86
+  if (detectedIsa() == Isa::AVX512 && __builtin_cpu_supports("avx512bw"))
+    return gemmInt8Avx512;
+  if (detectedIsa() == Isa::AVX512 || detectedIsa() == Isa::AVX2)
+    return gemmInt8Avx2;
+#endif
+  return gemmInt8Generic;
+}
+
+} // namespace
+
+/*
+ * @brief Integer matrix product C = A * B^T with 32-bit accumulation
+ */
+void gemmInt8(size_t m, size_t n, size_t k, const int8_t *a, size_t lda,
+              const int8_t *b, size_t ldb, int32_t *c, size_t ldc) {
+  static const GemmInt8Fn impl = selectGemmInt8();
+  impl(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+} // namespace kernels
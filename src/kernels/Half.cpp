@@ -0,0 +1,285 @@
+#include "../../include/kernels/Half.h"
+#include "../../include/kernels/Cpu.h"
+#include <cmath>
+#include <cstring>
+
+#if EASYLEARN_X86
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+
+namespace {
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+float bfloat16ToFloat(uint16_t value) {
+  return bitsToFloat(uint32_t(value) << 16);
+}
+
+uint16_t floatToBFloat16(float value) {
+  uint32_t bits = floatBits(value);
+
+  // keep NaNs quiet instead of letting rounding turn them into infinities
+  if ((bits & 0x7fffffff) > 0x7f800000)
+    return uint16_t((bits >> 16) | 0x40);
+
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return uint16_t(bits >> 16);
+}
+
+float float16ToFloat(uint16_t value) {
+  uint32_t sign = uint32_t(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+
+  if (exponent == 0) {
+    // zero or subnormal: mantissa * 2^-24
+    float magnitude = std::ldexp(float(mantissa), -24);
+    return bitsToFloat(sign | floatBits(magnitude));
+  }
+  if (exponent == 0x1f) // infinity or NaN (made quiet, as vcvtph2ps does)
+    return bitsToFloat(sign | 0x7f800000 | (mantissa << 13) |
+                       (mantissa != 0 ? 0x400000 : 0));
+
+  return bitsToFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+uint16_t floatToFloat16(float value) {
+  uint32_t bits = floatBits(value);
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7fffffff;
+
+  if (magnitude > 0x7f800000) // NaN: quiet, payload truncated
+    return sign | 0x7e00 | ((magnitude >> 13) & 0x3ff);
+  if (magnitude == 0x7f800000)
+    return sign | 0x7c00;
+  if (magnitude >= 0x477ff000) // 65520 and above round to infinity
+    return sign | 0x7c00;
+  if (magnitude < 0x38800000) { // below 2^-14: subnormal result
+    float scaled = bitsToFloat(magnitude) * 16777216.0f; // exact, * 2^24
+    return sign | uint16_t(std::nearbyint(scaled));
+  }
+
+  // rebias the exponent (127 -> 15) and round the mantissa to 10 bits
+  magnitude -= 0x38000000;
+  magnitude += 0xfff + ((magnitude >> 13) & 1);
+  return sign | uint16_t(magnitude >> 13);
+}
+
+typedef void (*WidenFn)(const uint16_t *, float *, size_t);
+typedef void (*NarrowFn)(const float *, uint16_t *, size_t);
+
+void widenBFloat16Scalar(const uint16_t *in, float *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = bfloat16ToFloat(in[i]);
+  }
+}
+
+void widenFloat16Scalar(const uint16_t *in, float *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = float16ToFloat(in[i]);
+  }
+}
+
+void narrowBFloat16Scalar(const float *in, uint16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = floatToBFloat16(in[i]);
+  }
+}
+
+void narrowFloat16Scalar(const float *in, uint16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = floatToFloat16(in[i]);
+  }
+}
+
+#if EASYLEARN_X86
+// bfloat16 is the upper half of a float: widening is a shift
+EASYLEARN_TARGET("avx512f")
+void widenBFloat16Avx512(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i half =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+    __m512i bits = _mm512_slli_epi32(_mm512_cvtepu16_epi32(half), 16);
+    _mm512_storeu_ps(out + i, _mm512_castsi512_ps(bits));
+  }
+  widenBFloat16Scalar(in + i, out + i, n - i);
+}
+
+EASYLEARN_TARGET("avx512f")
+void widenFloat16Avx512(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i half =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+    _mm512_storeu_ps(out + i, _mm512_cvtph_ps(half));
+  }
+  widenFloat16Scalar(in + i, out + i, n - i);
+}
+
+// vcvtneps2bf16 treats subnormal inputs as zero, which is below bfloat16
+// resolution for anything a layer would store
+EASYLEARN_TARGET("avx512f,avx512bf16")
+void narrowBFloat16Avx512(const float *in, uint16_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256bh half = _mm512_cvtneps_pbh(_mm512_loadu_ps(in + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        reinterpret_cast<__m256i &>(half));
+  }
+  narrowBFloat16Scalar(in + i, out + i, n - i);
+}
+
+EASYLEARN_TARGET("avx512f")
+void narrowFloat16Avx512(const float *in, uint16_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i half = _mm512_cvtps_ph(_mm512_loadu_ps(in + i),
+                                   _MM_FROUND_TO_NEAREST_INT);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), half);
+  }
+  narrowFloat16Scalar(in + i, out + i, n - i);
+}
+
+EASYLEARN_TARGET("avx2")
+void widenBFloat16Avx2(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(half), 16);
+    _mm256_storeu_ps(out + i, _mm256_castsi256_ps(bits));
+  }
+  widenBFloat16Scalar(in + i, out + i, n - i);
+}
+
+EASYLEARN_TARGET("avx,f16c")
+void widenFloat16F16c(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(half));
+  }
+  widenFloat16Scalar(in + i, out + i, n - i);
+}
+
+EASYLEARN_TARGET("avx,f16c")
+void narrowFloat16F16c(const float *in, uint16_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i half =
+        _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), half);
+  }
+  narrowFloat16Scalar(in + i, out + i, n - i);
+}
+#endif
+
+/*
+ * @brief Bulk float conversions picked once for the running CPU
+ */
+struct HalfKernels {
+  WidenFn widen_bfloat16 = widenBFloat16Scalar;
+  WidenFn widen_float16 = widenFloat16Scalar;
+  NarrowFn narrow_bfloat16 = narrowBFloat16Scalar;
+  NarrowFn narrow_float16 = narrowFloat16Scalar;
+
+  HalfKernels() {
+#if EASYLEARN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+      widen_bfloat16 = widenBFloat16Avx2;
+    }
+    if (__builtin_cpu_supports("f16c")) {
+      widen_float16 = widenFloat16F16c;
+      narrow_float16 = narrowFloat16F16c;
+    }
+    if (detectedIsa() == Isa::AVX512) {
+      widen_bfloat16 = widenBFloat16Avx512;
+      widen_float16 = widenFloat16Avx512;
+      narrow_float16 = narrowFloat16Avx512;
+      if (__builtin_cpu_supports("avx512bf16"))
+        narrow_bfloat16 = narrowBFloat16Avx512;
+    }
+#endif
+  }
+};
+
+const HalfKernels &halfKernels() {
+  static const HalfKernels kernels;
+  return kernels;
+}
+
+} // namespace
+
+/*
+ * @brief Convert one 16-bit value to float
+ */
+float halfToFloat(uint16_t value, HalfFormat format) {
+  return format == HalfFormat::BFloat16 ? bfloat16ToFloat(value)
+                                        : float16ToFloat(value);
+}
+
+/*
+ * @brief Round one float to the nearest 16-bit value
+ */
+uint16_t floatToHalf(float value, HalfFormat format) {
+  return format == HalfFormat::BFloat16 ? floatToBFloat16(value)
+                                        : floatToFloat16(value);
+}
+
+/*
+ * @brief Convert n 16-bit values to T (float or double)
+ */
+template <>
+void widenHalf<float>(const uint16_t *in, float *out, size_t n,
+                      HalfFormat format) {
+  const HalfKernels &k = halfKernels();
+  if (format == HalfFormat::BFloat16)
+    k.widen_bfloat16(in, out, n);
+  else
+    k.widen_float16(in, out, n);
+}
+
+template <>
+void widenHalf<double>(const uint16_t *in, double *out, size_t n,
+                       HalfFormat format) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = halfToFloat(in[i], format);
+  }
+}
+
+/*
+ * @brief Round n values of T (float or double) to 16-bit values
+ */
+template <>
+void narrowToHalf<float>(const float *in, uint16_t *out, size_t n,
+                         HalfFormat format) {
+  const HalfKernels &k = halfKernels();
+  if (format == HalfFormat::BFloat16)
+    k.narrow_bfloat16(in, out, n);
+  else
+    k.narrow_float16(in, out, n);
+}
+
+template <>
+void narrowToHalf<double>(const double *in, uint16_t *out, size_t n,
+                          HalfFormat format) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = floatToHalf(float(in[i]), format);
+  }
+}
+
+} // namespace kernels
@@ -0,0 +1,183 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+// Elementary functions on GCC vector types, shared by the SIMD kernels.
+// Everything is always_inline so that each caller compiled for a given
+// instruction set (EASYLEARN_TARGET) gets code for its register width.
+
+#include "../../include/kernels/Cpu.h"
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace kernels {
+namespace vecmath {
+
+/*
+ * @brief Vector types holding T (float or double) for one register width
+ * in bytes, with a same-sized integer vector for bit manipulation
+ */
+template <typename T, int VecBytes> struct VecTypes {
+  typedef T Vec __attribute__((vector_size(VecBytes)));
+  typedef typename std::conditional<sizeof(T) == 4, int32_t, int64_t>::type
+      Int;
+  typedef Int VecI __attribute__((vector_size(VecBytes)));
+  static constexpr int lanes = VecBytes / sizeof(T);
+};
+
+template <typename Vec, typename T> EASYLEARN_INLINE Vec load(const T *p) {
+  Vec v;
+  std::memcpy(&v, p, sizeof(Vec));
+  return v;
+}
+
+template <typename Vec, typename T>
+EASYLEARN_INLINE void store(T *p, const Vec &v) {
+  std::memcpy(p, &v, sizeof(Vec));
+}
+
+#define EASYLEARN_VEC typename VecTypes<T, VecBytes>::Vec
+
+/*
+ * @brief exp(x) with about 1 ulp error; inputs are clamped to the range
+ * where the result is a normal number ([-708, 709] for double,
+ * [-87, 88] for float)
+ *
+ * x = n * ln2 + r with |r| <= ln2 / 2, exp(r) from a polynomial (Taylor
+ * series to r^13 for double, Cephes expf minimax for float) and 2^n
+ * assembled directly in the exponent bits.
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE EASYLEARN_VEC exp(EASYLEARN_VEC x) {
+  typedef typename VecTypes<T, VecBytes>::Vec Vec;
+  typedef typename VecTypes<T, VecBytes>::VecI VecI;
+  constexpr bool single = sizeof(T) == 4;
+
+  // adding round_magic rounds to an integer kept in the low mantissa bits
+  const T round_magic = single ? T(0x1.8p23) : T(0x1.8p52);
+  const T log2e = T(1.4426950408889634);
+  const T ln2_hi = single ? T(0.693359375) : T(6.93145751953125e-1);
+  const T ln2_lo = single ? T(-2.12194440e-4) : T(1.42860682030941723212e-6);
+  const T lowest = single ? T(-87.0) : T(-708.0);
+  const T highest = single ? T(88.0) : T(709.0);
+
+  x = x < lowest ? lowest : x;
+  x = x > highest ? highest : x;
+
+  Vec t = x * log2e + round_magic;
+  Vec n = t - round_magic;
+  Vec r = x - n * ln2_hi;
+  r = r - n * ln2_lo;
+
+  Vec p;
+  if constexpr (single) {
+    p = r * T(1.9875691500e-4) + T(1.3981999507e-3);
+    p = p * r + T(8.3334519073e-3);
+    p = p * r + T(4.1665795894e-2);
+    p = p * r + T(1.6666665459e-1);
+    p = p * r + T(5.0000001201e-1);
+    p = p * r * r + r + T(1);
+  } else {
+    // Taylor series of exp(r) evaluated with Horner's scheme
+    p = r * T(1.0 / 6227020800.0) + T(1.0 / 479001600.0);
+    p = p * r + T(1.0 / 39916800.0);
+    p = p * r + T(1.0 / 3628800.0);
+    p = p * r + T(1.0 / 362880.0);
+    p = p * r + T(1.0 / 40320.0);
+    p = p * r + T(1.0 / 5040.0);
+    p = p * r + T(1.0 / 720.0);
+    p = p * r + T(1.0 / 120.0);
+    p = p * r + T(1.0 / 24.0);
+    p = p * r + T(1.0 / 6.0);
+    p = p * r + T(0.5);
+    p = p * r + T(1);
+    p = p * r + T(1);
+  }
+
+  // move n + bias into the exponent field
+  const int mantissa_bits = single ? 23 : 52;
+  const int exponent_bias = single ? 127 : 1023;
+  Vec magic = Vec{} + round_magic;
+  VecI bits = (VecI)t - (VecI)magic;
+  Vec scale = (Vec)((bits + exponent_bias) << mantissa_bits);
+  return p * scale;
+}
+
+/*
+ * @brief Logistic function 1 / (1 + exp(-x))
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE EASYLEARN_VEC sigmoid(EASYLEARN_VEC x) {
+  return T(1) / (T(1) + exp<T, VecBytes>(-x));
+}
+
+/*
+ * @brief Hyperbolic tangent
+ *
+ * A rational approximation near zero (where 1 - 2 / (e^2x + 1) would lose
+ * relative precision) and the exp-based identity elsewhere.
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE EASYLEARN_VEC tanh(EASYLEARN_VEC x) {
+  typedef typename VecTypes<T, VecBytes>::Vec Vec;
+
+  Vec ax = x < T(0) ? -x : x;
+
+  // |x| <= 0.625: x + x^3 P(x^2) / Q(x^2)
+  Vec s = x * x;
+  Vec p = s * T(-9.64399179425052238628e-1) - T(9.92877231001918586564e1);
+  p = p * s - T(1.61468768441708447952e3);
+  Vec q = s + T(1.12811678491632931402e2);
+  q = q * s + T(2.23548839060100448583e3);
+  q = q * s + T(4.84406305325125486048e3);
+  Vec small = x + x * s * (p / q);
+
+  // |x| > 0.625: sign(x) * (1 - 2 / (exp(2|x|) + 1))
+  Vec large = T(1) - T(2) / (exp<T, VecBytes>(T(2) * ax) + T(1));
+  large = x < T(0) ? -large : large;
+
+  return ax <= T(0.625) ? small : large;
+}
+
+/*
+ * @brief Approximate hyperbolic tangent without exp
+ *
+ * 7/6 rational function from Lambert's continued fraction, with the input
+ * clamped to [-4.8, 4.8] where the fraction is closest to +-1. Maximum
+ * absolute error is below 7.3e-5 over the whole real line.
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE EASYLEARN_VEC fastTanh(EASYLEARN_VEC x) {
+  typedef typename VecTypes<T, VecBytes>::Vec Vec;
+
+  x = x < T(-4.8) ? T(-4.8) : x;
+  x = x > T(4.8) ? T(4.8) : x;
+
+  Vec s = x * x;
+  Vec p = s + T(378);
+  p = p * s + T(17325);
+  p = p * s + T(135135);
+  Vec q = s * T(28) + T(3150);
+  q = q * s + T(62370);
+  q = q * s + T(135135);
+
+  Vec y = x * p / q;
+  y = y < T(-1) ? T(-1) : y;
+  return y > T(1) ? T(1) : y;
+}
+
+/*
+ * @brief Approximate logistic function, 0.5 + 0.5 * tanh(x / 2) with
+ * fastTanh; maximum absolute error below 3.7e-5
+ */
+template <typename T, int VecBytes>
+EASYLEARN_INLINE EASYLEARN_VEC fastSigmoid(EASYLEARN_VEC x) {
+  return T(0.5) + T(0.5) * fastTanh<T, VecBytes>(T(0.5) * x);
+}
+
+#undef EASYLEARN_VEC
+
+} // namespace vecmath
+} // namespace kernels
+
+#endif // !VECMATH_H